@@ -55,14 +55,20 @@ AxisWidget::on_change(const EvdevState& state)
 {
   int old_value = m_value;
   m_value = state.get_abs_value(m_code);
+
+  // use the extremes of the whole frame, not just the final value, so
+  // that a short flick to the limit isn't missed
+  if (state.get_abs_min(m_code) <= m_min && !m_saw_min) {
+    m_saw_min = true;
+    update();
+  }
+  if (state.get_abs_max(m_code) >= m_max && !m_saw_max) {
+    m_saw_max = true;
+    update();
+  }
+
   if (old_value != m_value)
   {
-    if (m_value <= m_min) {
-      m_saw_min = true;
-    }
-    if (m_value >= m_max) {
-      m_saw_max = true;
-    }
     update();
   }
 }
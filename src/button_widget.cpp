@@ -29,10 +29,11 @@ bool ButtonWidget::is_tested() const
 ButtonWidget::ButtonWidget(uint16_t code, QWidget* parent_) :
   QWidget(parent_),
   m_code(code),
+  m_name(QString::fromStdString(evdev_key_name(code))),
   m_value(0),
   m_tested(false)
 {
-  setToolTip(QString::fromStdString(evdev_key_name(m_code)));
+  setToolTip(m_name);
 }
 
 ButtonWidget::~ButtonWidget()
@@ -45,9 +46,13 @@ ButtonWidget::on_change(const EvdevState& state)
   int old_value = m_value;
   m_value = state.get_key_value(m_code);
 
-  // Releasing a button
-  if (old_value != 0 && m_value == 0)
-      m_tested = true;
+  // Releasing a button, the press may have happened within the same
+  // frame, so look at the peak value too
+  if ((old_value != 0 || state.get_key_peak(m_code) != 0) && m_value == 0 && !m_tested)
+  {
+    m_tested = true;
+    update();
+  }
 
   if (old_value != m_value)
   {
@@ -89,7 +94,7 @@ ButtonWidget::paintEvent(QPaintEvent* ev)
 
   painter.setPen(QColor(0, 0, 0));
   painter.drawText(0, 0, width(), height(), Qt::AlignVCenter | Qt::AlignCenter,
-                   QString::fromStdString(evdev_key_name(m_code)));
+                   m_name);
 
   // box outline
   painter.setPen(QColor(0, 0, 0));
@@ -27,6 +27,7 @@ class ButtonWidget : public QWidget
 
 private:
   uint16_t m_code;
+  QString m_name;
   int32_t m_value;
   bool m_tested;
 
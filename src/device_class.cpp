@@ -0,0 +1,92 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "device_class.hpp"
+
+#include "evdev_info.hpp"
+
+namespace {
+
+bool has_any_key(const EvdevInfo& info, uint16_t first, uint16_t last)
+{
+  for(uint16_t code = first; code <= last; ++code)
+  {
+    if (info.has_key(code))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+DeviceClass::Type
+DeviceClass::classify(const EvdevInfo& info)
+{
+  // a class may only be picked when the device really lacks the
+  // event types the class leaves out, everything else is generic
+  const bool has_mt = info.has_abs(ABS_MT_SLOT);
+
+  if (has_mt && info.rels.empty() &&
+      info.has_abs(ABS_MT_POSITION_X) && info.has_abs(ABS_MT_POSITION_Y))
+  {
+    return kTouch;
+  }
+  else if (has_mt)
+  {
+    return kGeneric;
+  }
+  else if (info.has_key(BTN_TOOL_PEN) && info.has_abs(ABS_X) && info.rels.empty())
+  {
+    return kTablet;
+  }
+  else if (has_any_key(info, BTN_JOYSTICK, BTN_THUMBR) &&
+           !info.abss.empty() && info.rels.empty())
+  {
+    return kGamepad;
+  }
+  else if (info.has_rel(REL_X) && info.has_rel(REL_Y) && info.has_key(BTN_LEFT) &&
+           info.abss.empty())
+  {
+    return kMouse;
+  }
+  else if (!info.keys.empty() && info.abss.empty() && info.rels.empty())
+  {
+    return kKeyboard;
+  }
+  else
+  {
+    return kGeneric;
+  }
+}
+
+const char*
+DeviceClass::name(Type type)
+{
+  switch(type)
+  {
+    case kGamepad: return "gamepad";
+    case kKeyboard: return "keyboard";
+    case kMouse: return "mouse";
+    case kTouch: return "touch";
+    case kTablet: return "tablet";
+    default: return "generic";
+  }
+}
+
+/* EOF */
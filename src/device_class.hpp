@@ -0,0 +1,103 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_DEVICE_CLASS_HPP
+#define HEADER_DEVICE_CLASS_HPP
+
+class EvdevInfo;
+
+/** Sorts devices into classes by their capabilities. A class only
+    tells which event types a device can send at all, so that
+    EvdevState can pick an update path that leaves out the rest. */
+class DeviceClass
+{
+public:
+  enum Type { kGeneric, kGamepad, kKeyboard, kMouse, kTouch, kTablet };
+
+  /** How much of an event type a class has, kMaybe is decided per
+      device at runtime */
+  enum Support { kNo, kMaybe, kYes };
+
+  static Type classify(const EvdevInfo& info);
+
+  /** "generic", "gamepad", "keyboard", "mouse", "touch" or "tablet" */
+  static const char* name(Type type);
+
+private:
+  DeviceClass(const DeviceClass&) = delete;
+  DeviceClass& operator=(const DeviceClass&) = delete;
+};
+
+/** The event types a device of class \a T can send, the generic class
+    can send all of them */
+template<DeviceClass::Type T>
+struct DeviceClassTraits
+{
+  static const DeviceClass::Support keys = DeviceClass::kMaybe;
+  static const DeviceClass::Support abss = DeviceClass::kMaybe;
+  static const DeviceClass::Support rels = DeviceClass::kMaybe;
+  static const DeviceClass::Support mt_slots = DeviceClass::kMaybe;
+};
+
+template<>
+struct DeviceClassTraits<DeviceClass::kGamepad>
+{
+  static const DeviceClass::Support keys = DeviceClass::kYes;
+  static const DeviceClass::Support abss = DeviceClass::kYes;
+  static const DeviceClass::Support rels = DeviceClass::kNo;
+  static const DeviceClass::Support mt_slots = DeviceClass::kNo;
+};
+
+template<>
+struct DeviceClassTraits<DeviceClass::kKeyboard>
+{
+  static const DeviceClass::Support keys = DeviceClass::kYes;
+  static const DeviceClass::Support abss = DeviceClass::kNo;
+  static const DeviceClass::Support rels = DeviceClass::kNo;
+  static const DeviceClass::Support mt_slots = DeviceClass::kNo;
+};
+
+template<>
+struct DeviceClassTraits<DeviceClass::kMouse>
+{
+  static const DeviceClass::Support keys = DeviceClass::kYes;
+  static const DeviceClass::Support abss = DeviceClass::kNo;
+  static const DeviceClass::Support rels = DeviceClass::kYes;
+  static const DeviceClass::Support mt_slots = DeviceClass::kNo;
+};
+
+template<>
+struct DeviceClassTraits<DeviceClass::kTouch>
+{
+  static const DeviceClass::Support keys = DeviceClass::kMaybe;
+  static const DeviceClass::Support abss = DeviceClass::kYes;
+  static const DeviceClass::Support rels = DeviceClass::kNo;
+  static const DeviceClass::Support mt_slots = DeviceClass::kYes;
+};
+
+template<>
+struct DeviceClassTraits<DeviceClass::kTablet>
+{
+  static const DeviceClass::Support keys = DeviceClass::kYes;
+  static const DeviceClass::Support abss = DeviceClass::kYes;
+  static const DeviceClass::Support rels = DeviceClass::kNo;
+  static const DeviceClass::Support mt_slots = DeviceClass::kNo;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,76 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_DIRTY_SET_HPP
+#define HEADER_DIRTY_SET_HPP
+
+#include <stddef.h>
+#include <vector>
+
+#include "memory_usage.hpp"
+
+/** A set of indices in [0, size), marking and clearing is O(1) per
+    element and iterating only touches the marked elements */
+class DirtySet
+{
+private:
+  std::vector<bool> m_flags;
+  std::vector<size_t> m_items;
+
+public:
+  DirtySet(size_t size = 0) :
+    m_flags(size, false),
+    m_items()
+  {
+    m_items.reserve(size);
+  }
+
+  void mark(size_t idx)
+  {
+    if (!m_flags[idx])
+    {
+      m_flags[idx] = true;
+      m_items.push_back(idx);
+    }
+  }
+
+  bool test(size_t idx) const { return m_flags[idx]; }
+  bool empty() const { return m_items.empty(); }
+
+  /** The marked indices in the order they were first marked */
+  const std::vector<size_t>& items() const { return m_items; }
+
+  MemoryUsage get_memory_usage() const
+  {
+    MemoryUsage usage;
+    usage.add(m_flags);
+    usage.add(m_items);
+    return usage;
+  }
+
+  void clear()
+  {
+    for(auto idx : m_items)
+    {
+      m_flags[idx] = false;
+    }
+    m_items.clear();
+  }
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,594 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "device_class.hpp"
+#include "event_time.hpp"
+#include "evdev_enum.hpp"
+#include "evdev_info.hpp"
+#include "evdev_recorder.hpp"
+#include "evdev_replay.hpp"
+#include "evdev_state.hpp"
+#include "event_filter.hpp"
+#include "event_writer.hpp"
+
+namespace {
+
+/** Builds an EvdevInfo for a full-size keyboard, i.e. a device that
+    has every key code */
+EvdevInfo make_keyboard_info()
+{
+  std::array<unsigned long, bits::nbits(EV_MAX)> bit{};
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit{};
+  std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit{};
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit{};
+
+  bit[bits::long_idx(EV_KEY)] |= bits::bit(EV_KEY);
+  for(size_t i = 0; i < KEY_MAX; ++i)
+  {
+    key_bit[bits::long_idx(i)] |= bits::bit(i);
+  }
+
+  input_id id{};
+  return EvdevInfo(0x10001, "benchmark keyboard", "bench/input0", id,
+                   bit, abs_bit, rel_bit, key_bit,
+                   std::array<AbsInfo, ABS_CNT>());
+}
+
+/** Builds an EvdevInfo for a gamepad with two sticks and a dozen
+    buttons */
+EvdevInfo make_gamepad_info()
+{
+  std::array<unsigned long, bits::nbits(EV_MAX)> bit{};
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit{};
+  std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit{};
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit{};
+  std::array<AbsInfo, ABS_CNT> absinfos;
+
+  bit[bits::long_idx(EV_KEY)] |= bits::bit(EV_KEY);
+  bit[bits::long_idx(EV_ABS)] |= bits::bit(EV_ABS);
+  for(uint16_t code : { uint16_t(ABS_X), uint16_t(ABS_Y), uint16_t(ABS_RX), uint16_t(ABS_RY) })
+  {
+    abs_bit[bits::long_idx(code)] |= bits::bit(code);
+
+    input_absinfo absinfo{};
+    absinfo.minimum = -32768;
+    absinfo.maximum = 32767;
+    absinfos[code] = AbsInfo(absinfo);
+  }
+  for(size_t code = BTN_SOUTH; code <= BTN_THUMBR; ++code)
+  {
+    key_bit[bits::long_idx(code)] |= bits::bit(code);
+  }
+
+  input_id id{};
+  return EvdevInfo(0x10001, "benchmark gamepad", "bench/input0", id,
+                   bit, abs_bit, rel_bit, key_bit, absinfos);
+}
+
+/** Synthesizes \a count events of a 1 kHz gamepad that moves its left
+    stick in circles, two axis events and a EV_SYN per millisecond */
+std::vector<struct input_event> make_gamepad_events(size_t count)
+{
+  std::vector<struct input_event> events(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    const size_t frame = i / 3;
+    struct input_event& ev = events[i];
+    set_event_usec(ev, 1000000000000ull + frame * 1000);
+
+    const double angle = static_cast<double>(frame) * 0.002;
+    switch(i % 3)
+    {
+      case 0:
+        ev.type = EV_ABS;
+        ev.code = ABS_X;
+        ev.value = static_cast<int32_t>(32767.0 * std::cos(angle));
+        break;
+
+      case 1:
+        ev.type = EV_ABS;
+        ev.code = ABS_Y;
+        ev.value = static_cast<int32_t>(32767.0 * std::sin(angle));
+        break;
+
+      default:
+        ev.type = EV_SYN;
+        ev.code = SYN_REPORT;
+        ev.value = 0;
+        break;
+    }
+  }
+  return events;
+}
+
+/** Builds an EvdevInfo that has exactly the given codes */
+EvdevInfo make_info(const char* name,
+                    std::initializer_list<uint16_t> keys,
+                    std::initializer_list<uint16_t> abss,
+                    std::initializer_list<uint16_t> rels)
+{
+  std::array<unsigned long, bits::nbits(EV_MAX)> bit{};
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit{};
+  std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit{};
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit{};
+  std::array<AbsInfo, ABS_CNT> absinfos;
+
+  for(uint16_t code : keys)
+  {
+    bit[bits::long_idx(EV_KEY)] |= bits::bit(EV_KEY);
+    key_bit[bits::long_idx(code)] |= bits::bit(code);
+  }
+  for(uint16_t code : abss)
+  {
+    bit[bits::long_idx(EV_ABS)] |= bits::bit(EV_ABS);
+    abs_bit[bits::long_idx(code)] |= bits::bit(code);
+
+    input_absinfo absinfo{};
+    absinfo.maximum = code == ABS_MT_SLOT ? 9 : 4095;
+    absinfos[code] = AbsInfo(absinfo);
+  }
+  for(uint16_t code : rels)
+  {
+    bit[bits::long_idx(EV_REL)] |= bits::bit(EV_REL);
+    rel_bit[bits::long_idx(code)] |= bits::bit(code);
+  }
+
+  input_id id{};
+  return EvdevInfo(0x10001, name, "bench/input0", id,
+                   bit, abs_bit, rel_bit, key_bit, absinfos);
+}
+
+void push_event(std::vector<struct input_event>& events, uint64_t usec,
+                uint16_t type, uint16_t code, int32_t value)
+{
+  struct input_event ev;
+  set_event_usec(ev, usec);
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  events.push_back(ev);
+}
+
+/** Synthesizes \a count events of a 1 kHz device, \a func appends
+    the events of a frame, the EV_SYN is added here */
+template<typename Func>
+std::vector<struct input_event> make_events(size_t count, Func func)
+{
+  std::vector<struct input_event> events;
+  events.reserve(count + 16);
+  for(uint64_t frame = 0; events.size() < count; ++frame)
+  {
+    const uint64_t usec = 1000000000000ull + frame * 1000;
+    func(events, usec, static_cast<int32_t>(frame));
+    push_event(events, usec, EV_SYN, SYN_REPORT, 0);
+  }
+  events.resize(count);
+  return events;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** The std::find() based lookup EvdevInfo used before the index tables */
+size_t linear_key_idx(const EvdevInfo& info, uint16_t code)
+{
+  auto it = std::find(info.keys.begin(), info.keys.end(), code);
+  return it != info.keys.end() ? static_cast<size_t>(it - info.keys.begin()) : EvdevInfo::npos;
+}
+
+template<typename Func>
+void run(const char* name, size_t iterations, Func func)
+{
+  size_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < iterations; ++i)
+  {
+    sum += func(static_cast<uint16_t>(i % KEY_MAX));
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  std::cout << std::setw(24) << std::left << name
+            << std::setw(10) << std::right << std::fixed << std::setprecision(2)
+            << ns / static_cast<double>(iterations) << " ns/lookup"
+            << "  (checksum " << sum << ")\n";
+}
+
+void bench_idx_lookup(size_t iterations)
+{
+  const EvdevInfo info = make_keyboard_info();
+
+  std::cout << "key index lookup, " << info.keys.size() << " keys, "
+            << iterations << " lookups\n";
+  run("linear (std::find)", iterations,
+      [&info](uint16_t code) { return linear_key_idx(info, code); });
+  run("table", iterations,
+      [&info](uint16_t code) { return info.get_key_idx(code); });
+}
+
+/** The per event cost of EvdevState::update() for a full-size
+    keyboard, with the key index lookup it depends on, for keys at
+    the start and the end of the key list and for keys spread over
+    all of it */
+void bench_key_update(size_t count)
+{
+  const EvdevInfoPtr info = std::make_shared<const EvdevInfo>(make_keyboard_info());
+  const uint16_t first_key = info->keys.front();
+  const uint16_t last_key = info->keys.back();
+
+  std::cout << "\nkey state update, " << info->keys.size() << " keys, " << count << " events\n";
+  for(int pattern = 0; pattern < 3; ++pattern)
+  {
+    const std::vector<struct input_event> events =
+      make_events(count, [&](std::vector<struct input_event>& out, uint64_t usec, int32_t frame) {
+          const uint16_t code =
+            pattern == 0 ? first_key :
+            pattern == 1 ? last_key :
+            info->keys[static_cast<size_t>(frame / 2) % info->keys.size()];
+          push_event(out, usec, EV_KEY, code, 1 - frame % 2);
+        });
+
+    EvdevState state(info);
+    state.set_frame_rate(0);
+
+    auto start = std::chrono::steady_clock::now();
+    for(const auto& ev : events)
+    {
+      state.update(ev);
+    }
+    const double secs = seconds_since(start);
+
+    std::cout << "  " << std::setw(22) << std::left
+              << (pattern == 0 ? "first key" : pattern == 1 ? "last key" : "all keys")
+              << std::right << std::fixed << std::setprecision(2)
+              << std::setw(8) << secs * 1e9 / static_cast<double>(count) << " ns/event\n";
+  }
+}
+
+void bench_name_lookup(size_t iterations)
+{
+  std::vector<std::string> names;
+  std::map<std::string, uint16_t> name_map;
+  for(uint16_t code = 0; code < KEY_CNT; ++code)
+  {
+    if (const char* name = evdev_key_cname(code))
+    {
+      names.push_back(name);
+      name_map[name] = code;
+    }
+  }
+
+  std::cout << "\nname to code lookup, " << names.size() << " key names, "
+            << iterations << " lookups\n";
+  run("std::map", iterations,
+      [&names, &name_map](uint16_t i) {
+        return name_map.find(names[i % names.size()])->second;
+      });
+  run("perfect hash", iterations,
+      [&names](uint16_t i) {
+        uint16_t type = 0;
+        uint16_t code = 0;
+        evdev_lookup_code(names[i % names.size()], type, code);
+        return code;
+      });
+}
+
+std::string make_temp_file()
+{
+  char filename[] = "/tmp/evdev-bench-XXXXXX";
+  int fd = mkstemp(filename);
+  if (fd < 0)
+  {
+    throw std::runtime_error(std::string("mkstemp: ") + strerror(errno));
+  }
+  close(fd);
+  return filename;
+}
+
+void bench_recording(size_t count)
+{
+  const EvdevInfo info = make_gamepad_info();
+  const std::vector<struct input_event> events = make_gamepad_events(count);
+  const std::string filename = make_temp_file();
+
+  uint64_t bytes;
+  auto start = std::chrono::steady_clock::now();
+  {
+    EvdevRecorder recorder(filename, info);
+    recorder.record(events.data(), events.size());
+    bytes = recorder.get_bytes();
+  }
+  const double secs = seconds_since(start);
+  unlink(filename.c_str());
+
+  const double bytes_per_event = static_cast<double>(bytes) / static_cast<double>(count);
+  std::cout << "\nrecording, 1 kHz gamepad, " << count << " events\n"
+            << std::fixed << std::setprecision(2)
+            << "  " << static_cast<double>(count) / secs / 1e6 << " M events/s, "
+            << bytes_per_event << " bytes/event, "
+            << bytes_per_event * 3000 * 3600 / 1e6 << " MB per hour of continuous motion\n";
+}
+
+/** Replays \a filename as fast as possible through EvdevState, which
+    measures the state update and change dispatch without a GUI */
+void bench_replay(const std::string& filename)
+{
+  EvdevReplay replay(filename);
+  EvdevState state(replay.get_info());
+  state.set_frame_rate(0);
+
+  size_t count = 0;
+  auto start = std::chrono::steady_clock::now();
+  size_t n;
+  while((n = replay.feed(state, 65536)) > 0)
+  {
+    count += n;
+  }
+  const double secs = seconds_since(start);
+
+  std::cout << "\nreplay of '" << replay.get_info()->name << "', " << count << " events\n"
+            << std::fixed << std::setprecision(2)
+            << "  " << static_cast<double>(count) / secs / 1e6 << " M events/s through EvdevState\n";
+}
+
+/** Records a synthetic gamepad session and replays it */
+void bench_synthetic_replay(size_t count)
+{
+  const std::string filename = make_temp_file();
+  {
+    const std::vector<struct input_event> events = make_gamepad_events(count);
+    EvdevRecorder recorder(filename, make_gamepad_info());
+    recorder.record(events.data(), events.size());
+  }
+  bench_replay(filename);
+  unlink(filename.c_str());
+}
+
+/** Formats \a count events into /dev/null, which measures the cost
+    of evdev-test's output without the terminal or disk */
+void bench_event_writer(size_t count)
+{
+  const std::vector<struct input_event> events = make_gamepad_events(count);
+  int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    throw std::runtime_error(std::string("/dev/null: ") + strerror(errno));
+  }
+
+  std::cout << "\nevent output, 1 kHz gamepad, " << count << " events\n";
+  for(const char* format : { "text", "csv", "jsonl" })
+  {
+    uint64_t bytes;
+    auto start = std::chrono::steady_clock::now();
+    {
+      EventWriter writer(fd, EventWriter::parse_format(format));
+      writer.write(events.data(), events.size());
+      writer.flush();
+      bytes = writer.get_bytes();
+    }
+    const double secs = seconds_since(start);
+
+    std::cout << "  " << std::setw(6) << std::left << format << std::right
+              << std::fixed << std::setprecision(2)
+              << std::setw(8) << static_cast<double>(count) / secs / 1e6 << " M events/s, "
+              << static_cast<double>(bytes) / static_cast<double>(count) << " bytes/event\n";
+  }
+  close(fd);
+}
+
+void bench_event_filter(size_t count)
+{
+  std::vector<struct input_event> events = make_gamepad_events(count);
+
+  std::cout << "\nevent filter, 1 kHz gamepad, " << count << " events\n";
+  for(const char* expr : { "BTN_SOUTH", "type==EV_ABS && code in {ABS_X,ABS_Y} && |value|>100" })
+  {
+    const EventFilter filter(expr);
+    std::vector<struct input_event> copy = events;
+
+    auto start = std::chrono::steady_clock::now();
+    const size_t passed = filter.filter(copy.data(), copy.size(), false);
+    const double secs = seconds_since(start);
+
+    std::cout << "  " << std::fixed << std::setprecision(2)
+              << std::setw(8) << secs * 1e9 / static_cast<double>(count) << " ns/event, "
+              << passed << " passed '" << expr << "'\n";
+  }
+}
+
+/** Feeds \a events through an EvdevState, returns the events per
+    second and a checksum of the final state */
+double feed_state(const EvdevInfoPtr& info, bool specialize,
+                  const std::vector<struct input_event>& events, long& checksum)
+{
+  EvdevState state(info, specialize);
+  state.set_frame_rate(0);
+
+  auto start = std::chrono::steady_clock::now();
+  for(const auto& ev : events)
+  {
+    state.update(ev);
+  }
+  const double secs = seconds_since(start);
+
+  checksum = 0;
+  for(uint16_t code : info->keys) { checksum += state.get_key_value(code); }
+  for(uint16_t code : info->abss) { checksum += state.get_abs_value(code); }
+  const MultitouchSlots& mt_slots = state.get_mt_slots();
+  for(uint16_t code : mt_slots.get_codes())
+  {
+    for(size_t slot = 0; slot < mt_slots.size(); ++slot)
+    {
+      checksum += mt_slots.get(slot, code);
+    }
+  }
+  return static_cast<double>(events.size()) / secs;
+}
+
+/** The class specific update paths of EvdevState against the
+    generic one */
+void bench_state_engines(size_t count)
+{
+  struct Case
+  {
+    DeviceClass::Type type;
+    EvdevInfo info;
+    std::vector<struct input_event> events;
+  };
+
+  std::vector<Case> cases;
+  cases.push_back({ DeviceClass::kGamepad, make_gamepad_info(), make_gamepad_events(count) });
+  cases.push_back({ DeviceClass::kKeyboard, make_keyboard_info(),
+        make_events(count, [](std::vector<struct input_event>& events, uint64_t usec, int32_t frame) {
+            const uint16_t code = static_cast<uint16_t>(KEY_Q + (frame / 2) % 10);
+            push_event(events, usec, EV_MSC, MSC_SCAN, code);
+            push_event(events, usec, EV_KEY, code, 1 - frame % 2);
+          }) });
+  cases.push_back({ DeviceClass::kMouse,
+        make_info("benchmark mouse", { BTN_LEFT, BTN_RIGHT, BTN_MIDDLE }, {},
+                  { REL_X, REL_Y, REL_WHEEL }),
+        make_events(count, [](std::vector<struct input_event>& events, uint64_t usec, int32_t frame) {
+            push_event(events, usec, EV_REL, REL_X, frame % 7 - 3);
+            push_event(events, usec, EV_REL, REL_Y, frame % 5 - 2);
+          }) });
+  cases.push_back({ DeviceClass::kTouch,
+        make_info("benchmark touchscreen", { BTN_TOUCH },
+                  { ABS_X, ABS_Y, ABS_MT_SLOT, ABS_MT_TRACKING_ID,
+                    ABS_MT_POSITION_X, ABS_MT_POSITION_Y,
+                    ABS_MT_PRESSURE, ABS_MT_TOUCH_MAJOR }, {}),
+        make_events(count, [](std::vector<struct input_event>& events, uint64_t usec, int32_t frame) {
+            // ten fingers
+            for(int32_t slot = 0; slot < 10; ++slot)
+            {
+              push_event(events, usec, EV_ABS, ABS_MT_SLOT, slot);
+              push_event(events, usec, EV_ABS, ABS_MT_POSITION_X, (frame + slot * 400) % 4096);
+              push_event(events, usec, EV_ABS, ABS_MT_POSITION_Y, (frame * 3 + slot * 400) % 4096);
+              push_event(events, usec, EV_ABS, ABS_MT_PRESSURE, (frame + slot) % 256);
+              push_event(events, usec, EV_ABS, ABS_MT_TOUCH_MAJOR, slot * 10);
+            }
+            push_event(events, usec, EV_ABS, ABS_X, frame % 4096);
+            push_event(events, usec, EV_ABS, ABS_Y, (frame * 3) % 4096);
+          }) });
+  cases.push_back({ DeviceClass::kTablet,
+        make_info("benchmark tablet", { BTN_TOOL_PEN, BTN_TOUCH, BTN_STYLUS },
+                  { ABS_X, ABS_Y, ABS_PRESSURE, ABS_TILT_X }, {}),
+        make_events(count, [](std::vector<struct input_event>& events, uint64_t usec, int32_t frame) {
+            push_event(events, usec, EV_ABS, ABS_X, frame % 4096);
+            push_event(events, usec, EV_ABS, ABS_Y, (frame * 3) % 4096);
+            push_event(events, usec, EV_ABS, ABS_PRESSURE, frame % 1024);
+          }) });
+
+  std::cout << "\nstate update per device class, " << count << " events\n";
+  for(auto& c : cases)
+  {
+    const EvdevInfoPtr info = std::make_shared<const EvdevInfo>(std::move(c.info));
+    if (DeviceClass::classify(*info) != c.type)
+    {
+      throw std::runtime_error(std::string("misclassified ") + info->name);
+    }
+
+    // best of a few alternating runs, a single run is too noisy to
+    // compare
+    long specialized_checksum = 0;
+    long generic_checksum = 0;
+    double specialized = 0.0;
+    double generic = 0.0;
+    for(int run_idx = 0; run_idx < 3; ++run_idx)
+    {
+      specialized = std::max(specialized, feed_state(info, true, c.events, specialized_checksum));
+      generic = std::max(generic, feed_state(info, false, c.events, generic_checksum));
+    }
+    if (specialized_checksum != generic_checksum)
+    {
+      throw std::runtime_error(std::string("state mismatch for ") + info->name);
+    }
+
+    std::cout << "  " << std::setw(9) << std::left << DeviceClass::name(c.type) << std::right
+              << std::fixed << std::setprecision(2)
+              << std::setw(8) << specialized / 1e6 << " M events/s specialized, "
+              << std::setw(8) << generic / 1e6 << " M events/s generic\n";
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  size_t iterations = 10000000;
+  std::string replay_filename;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-h") == 0 ||
+        strcmp(argv[i], "--help") == 0)
+    {
+      std::cout << "Usage: " << argv[0] << " [--replay FILE] [ITERATIONS]\n"
+                << "\n"
+                << "   --replay FILE  Only measure replaying the recording FILE\n";
+      return 0;
+    }
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+    {
+      replay_filename = argv[++i];
+    }
+    else
+    {
+      iterations = static_cast<size_t>(std::stoul(argv[i]));
+    }
+  }
+
+  try
+  {
+    if (!replay_filename.empty())
+    {
+      bench_replay(replay_filename);
+    }
+    else
+    {
+      bench_idx_lookup(iterations);
+      bench_key_update(iterations);
+      bench_name_lookup(iterations);
+      bench_recording(iterations);
+      bench_synthetic_replay(iterations);
+      bench_state_engines(iterations);
+      bench_event_writer(iterations);
+      bench_event_filter(iterations);
+    }
+  }
+  catch(const std::exception& err)
+  {
+    std::cerr << "error: " << err.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+/* EOF */
@@ -23,11 +23,13 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <iostream>
 
 #include "util.hpp"
 #include "bits.hpp"
+#include "event_filter.hpp"
 
 std::unique_ptr<EvdevDevice>
 EvdevDevice::open(const std::string& filename)
@@ -41,6 +43,15 @@ EvdevDevice::open(const std::string& filename)
   }
   else
   {
+    // the default CLOCK_REALTIME jumps with the wall clock, monotonic
+    // timestamps can be compared against clock_gettime() to measure
+    // latency
+    int clock_id = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clock_id) < 0)
+    {
+      std::cout << filename << ": EVIOCSCLOCKID: " << strerror(errno) << '\n';
+    }
+
     auto controller = util::make_unique<EvdevDevice>(fd, filename);
     //controller->read_evdev_info();
     //controller->start_qsocket_notifier();
@@ -155,7 +166,7 @@ EvdevDevice::read_evdev_info()
     ioctl(m_fd, EVIOCGBIT(EV_KEY, KEY_MAX), key_bit.data());
   }
 
-  std::map<uint16_t, AbsInfo> absinfos;
+  std::array<AbsInfo, ABS_CNT> absinfos;
   for(uint16_t i = 0; i < ABS_MAX; ++i)
   {
     if (bits::test_bit(i, abs_bit.data()))
@@ -180,20 +191,188 @@ EvdevDevice::read_evdev_info()
                    std::move(abs_bit),
                    std::move(rel_bit),
                    std::move(key_bit),
-                   std::move(absinfos));
+                   absinfos);
+}
+
+EvdevIdentity
+EvdevDevice::read_identity()
+{
+  EvdevIdentity identity;
+
+  struct stat st;
+  if (fstat(m_fd, &st) < 0)
+  {
+    std::ostringstream out;
+    out << m_filename << ": " << strerror(errno);
+    throw std::runtime_error(out.str());
+  }
+  identity.rdev = st.st_rdev;
+  identity.ino = st.st_ino;
+
+  if (ioctl(m_fd, EVIOCGID, &identity.id) < 0)
+  {
+    std::ostringstream out;
+    out << m_filename << ": " << strerror(errno);
+    throw std::runtime_error(out.str());
+  }
+
+  char c_phys[1024] = "";
+  if (ioctl(m_fd, EVIOCGPHYS(sizeof(c_phys)), c_phys) >= 0)
+  {
+    identity.phys = c_phys;
+  }
+
+  return identity;
+}
+
+void
+EvdevDevice::read_mt_slots(uint32_t code, size_t num_slots, std::vector<int32_t>& values)
+{
+  values.resize(num_slots);
+  if (num_slots == 0)
+  {
+    return;
+  }
+
+  // the request is the code followed by one value per slot
+  std::vector<int32_t> request(num_slots + 1);
+  request[0] = static_cast<int32_t>(code);
+  if (ioctl(m_fd, EVIOCGMTSLOTS(request.size() * sizeof(int32_t)), request.data()) < 0)
+  {
+    // a device that doesn't report this code, or an old kernel
+    std::fill(values.begin(), values.end(), code == ABS_MT_TRACKING_ID ? -1 : 0);
+  }
+  else
+  {
+    std::copy(request.begin() + 1, request.end(), values.begin());
+  }
+}
+
+bool
+EvdevDevice::read_snapshot(EvdevSnapshot& snapshot)
+{
+  // keys, switches and LEDs come in one ioctl each, axes need one
+  // per axis, the MT axes only report their current slot
+  if (ioctl(m_fd, EVIOCGKEY(sizeof(snapshot.key_bit)), snapshot.key_bit.data()) < 0 ||
+      ioctl(m_fd, EVIOCGBIT(EV_ABS, sizeof(snapshot.abs_bit)), snapshot.abs_bit.data()) < 0)
+  {
+    return false;
+  }
+
+  size_t num_slots = 0;
+  for(size_t code = 0; code < ABS_CNT; ++code)
+  {
+    if (snapshot.has_abs(code))
+    {
+      struct input_absinfo absinfo;
+      if (ioctl(m_fd, EVIOCGABS(code), &absinfo) < 0)
+      {
+        return false;
+      }
+      snapshot.abs_values[code] = absinfo.value;
+
+      if (code == ABS_MT_SLOT)
+      {
+        num_slots = EvdevSnapshot::get_num_mt_slots(absinfo.maximum);
+      }
+    }
+  }
+
+  for(uint16_t code = ABS_MT_TOUCH_MAJOR; code <= ABS_MT_TOOL_Y; ++code)
+  {
+    if (snapshot.has_abs(code))
+    {
+      read_mt_slots(code, num_slots, snapshot.mt_values[code - ABS_MT_TOUCH_MAJOR]);
+    }
+  }
+
+  // treat a failure as no switch or LED being set
+  if (ioctl(m_fd, EVIOCGSW(sizeof(snapshot.sw_bit)), snapshot.sw_bit.data()) < 0)
+  {
+    snapshot.sw_bit.fill(0);
+  }
+  if (ioctl(m_fd, EVIOCGLED(sizeof(snapshot.led_bit)), snapshot.led_bit.data()) < 0)
+  {
+    snapshot.led_bit.fill(0);
+  }
+
+  return true;
+}
+
+bool
+EvdevDevice::set_event_mask(const EventFilter& filter)
+{
+#ifdef EVIOCSMASK
+  // the types the kernel keeps a code mask for and their sizes
+  static const struct { uint16_t type; size_t count; } kMaskTypes[] = {
+    { EV_KEY, KEY_CNT }, { EV_REL, REL_CNT }, { EV_ABS, ABS_CNT },
+    { EV_MSC, MSC_CNT }, { EV_SW, SW_CNT }, { EV_LED, LED_CNT },
+    { EV_SND, SND_CNT }, { EV_FF, FF_CNT }
+  };
+
+  std::array<unsigned long, bits::nbits(EV_CNT)> type_bit{};
+  std::array<unsigned long, bits::nbits(KEY_CNT)> code_bit;
+
+  for(size_t type = 0; type < EV_CNT; ++type)
+  {
+    size_t count = 0;
+    for(const auto& mask_type : kMaskTypes)
+    {
+      if (mask_type.type == type)
+      {
+        count = mask_type.count;
+      }
+    }
+
+    // types without a code mask are all or nothing
+    code_bit.fill(0);
+    bool any = false;
+    for(size_t code = 0; code < (count ? count : KEY_CNT); ++code)
+    {
+      if (filter.may_accept(static_cast<uint16_t>(type), static_cast<uint16_t>(code)))
+      {
+        code_bit[bits::long_idx(code)] |= bits::bit(code);
+        any = true;
+      }
+    }
+
+    if (any)
+    {
+      type_bit[bits::long_idx(type)] |= bits::bit(type);
+    }
+
+    if (count)
+    {
+      struct input_mask mask;
+      mask.type = static_cast<uint32_t>(type);
+      mask.codes_size = static_cast<uint32_t>(bits::nbits(count) * sizeof(unsigned long));
+      mask.codes_ptr = reinterpret_cast<uintptr_t>(code_bit.data());
+      if (ioctl(m_fd, EVIOCSMASK, &mask) < 0)
+      {
+        return false;
+      }
+    }
+  }
+
+  // the mask of EV_SYN is the one of the event types, EV_SYN itself
+  // always gets through
+  struct input_mask mask;
+  mask.type = EV_SYN;
+  mask.codes_size = static_cast<uint32_t>(sizeof(type_bit));
+  mask.codes_ptr = reinterpret_cast<uintptr_t>(type_bit.data());
+  return ioctl(m_fd, EVIOCSMASK, &mask) == 0;
+#else
+  return false;
+#endif
 }
 
 ssize_t
 EvdevDevice::read_events(struct input_event* ev, size_t count)
 {
   ssize_t rd = ::read(m_fd, ev, sizeof(struct input_event) * count);
-  if (rd < EAGAIN)
-  {
-    return 0;
-  }
-  else if (rd < 0)
+  if (rd < 0)
   {
-    return rd;
+    return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
   }
   else
   {
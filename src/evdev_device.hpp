@@ -18,11 +18,47 @@
 #define HEADER_EVDEV_DEVICE_HPP
 
 #include <memory>
+#include <stdint.h>
 #include <string>
+#include <sys/types.h>
+#include <vector>
 
+#include "event_source.hpp"
 #include "evdev_info.hpp"
 
-class EvdevDevice
+/** Identifies a device cheaply, without reading its full
+    capabilities, used to detect when a cached EvdevInfo is stale */
+class EvdevIdentity
+{
+public:
+  dev_t rdev;
+  ino_t ino;
+  struct input_id id;
+  std::string phys;
+
+  EvdevIdentity() :
+    rdev(),
+    ino(),
+    id(),
+    phys()
+  {}
+
+  bool operator==(const EvdevIdentity& rhs) const
+  {
+    return
+      rdev == rhs.rdev &&
+      ino == rhs.ino &&
+      id.bustype == rhs.id.bustype &&
+      id.vendor == rhs.id.vendor &&
+      id.product == rhs.id.product &&
+      id.version == rhs.id.version &&
+      phys == rhs.phys;
+  }
+
+  bool operator!=(const EvdevIdentity& rhs) const { return !(*this == rhs); }
+};
+
+class EvdevDevice : public EventSource
 {
 private:
   int m_fd;
@@ -31,11 +67,18 @@ private:
 public:
   static std::unique_ptr<EvdevDevice> open(const std::string& filename);
   EvdevDevice(int fd, const std::string& filename);
-  ~EvdevDevice();
+  ~EvdevDevice() override;
 
-  EvdevInfo read_evdev_info();
-  ssize_t read_events(struct input_event* ev, size_t count);
-  int get_fd() const { return m_fd; }
+  EvdevInfo read_evdev_info() override;
+  EvdevIdentity read_identity();
+  const std::string& get_filename() const override { return m_filename; }
+  ssize_t read_events(struct input_event* ev, size_t count) override;
+  int get_fd() const override { return m_fd; }
+  bool read_snapshot(EvdevSnapshot& snapshot) override;
+  bool set_event_mask(const EventFilter& filter) override;
+
+private:
+  void read_mt_slots(uint32_t code, size_t num_slots, std::vector<int32_t>& values);
 
 private:
   EvdevDevice(const EvdevDevice&) = delete;
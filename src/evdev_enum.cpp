@@ -14,86 +14,132 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+
 #include "evdev_enum.hpp"
 
 #include <linux/input.h>
+#include <string.h>
+
+namespace {
 
-class EvDevRelEnum : public EnumBox<uint16_t>
+struct NameHashEntry
 {
-public:
-  EvDevRelEnum() :
-    EnumBox<uint16_t>("EV_REL")
-  {
-#  include "rel_list.x"
-  }
+  const char* name;
+  uint16_t type;
+  uint16_t code;
 };
 
-class EvDevAbsEnum : public EnumBox<uint16_t>
+#include "evdev_names.x"
+
+/** FNV-1a, must match fnv1a() in gen_event_lists.py */
+uint32_t name_hash(const char* name, size_t len, uint32_t seed)
 {
-public:
-  EvDevAbsEnum() :
-    EnumBox<uint16_t>("EV_ABS")
+  uint32_t h = 2166136261u ^ seed;
+  for(size_t i = 0; i < len; ++i)
   {
-#  include "abs_list.x"
+    h ^= static_cast<unsigned char>(name[i]);
+    h *= 16777619u;
   }
-};
+  return h;
+}
 
-class EvDevKeyEnum : public EnumBox<uint16_t>
+template<size_t N>
+const char* lookup(const char* const (&names)[N], uint16_t code)
 {
-public:
-  EvDevKeyEnum() :
-    EnumBox<uint16_t>("EV_KEY")
-  {
-#  include "key_list.x"
-  }
-};
+  return code < N ? names[code] : nullptr;
+}
 
-std::string evdev_abs_name(uint16_t code)
+std::string name_or_number(const char* name, const char* prefix, uint16_t code)
 {
-  static EvDevAbsEnum evdev_abs_names;
-  auto it = evdev_abs_names.find(code);
-  if (it == evdev_abs_names.end())
+  if (name)
   {
-    std::ostringstream out;
-    out << "ABS_#" << code;
-    return out.str();
+    return name;
   }
   else
   {
-    return it->second;
+    return prefix + std::to_string(code);
   }
 }
 
-std::string evdev_key_name(uint16_t code)
+} // namespace
+
+const char* evdev_type_cname(uint16_t type)
 {
-  static EvDevKeyEnum evdev_key_names;
-  auto it = evdev_key_names.find(code);
-  if (it == evdev_key_names.end())
-  {
-    std::ostringstream out;
-    out << "KEY_#" << code;
-    return out.str();
-  }
-  else
+  return lookup(ev_names, type);
+}
+
+const char* evdev_code_cname(uint16_t type, uint16_t code)
+{
+  switch(type)
   {
-    return it->second;
+    case EV_SYN: return lookup(syn_names, code);
+    case EV_KEY: return lookup(key_names, code);
+    case EV_REL: return lookup(rel_names, code);
+    case EV_ABS: return lookup(abs_names, code);
+    case EV_MSC: return lookup(msc_names, code);
+    case EV_SW: return lookup(sw_names, code);
+    case EV_LED: return lookup(led_names, code);
+    case EV_SND: return lookup(snd_names, code);
+    case EV_REP: return lookup(rep_names, code);
+    default: return nullptr;
   }
 }
 
+const char* evdev_abs_cname(uint16_t code)
+{
+  return lookup(abs_names, code);
+}
+
+const char* evdev_key_cname(uint16_t code)
+{
+  return lookup(key_names, code);
+}
+
+const char* evdev_rel_cname(uint16_t code)
+{
+  return lookup(rel_names, code);
+}
+
+std::string evdev_abs_name(uint16_t code)
+{
+  return name_or_number(evdev_abs_cname(code), "ABS_#", code);
+}
+
+std::string evdev_key_name(uint16_t code)
+{
+  return name_or_number(evdev_key_cname(code), "KEY_#", code);
+}
+
 std::string evdev_rel_name(uint16_t code)
 {
-  static EvDevRelEnum evdev_rel_names;
-  auto it = evdev_rel_names.find(code);
-  if (it == evdev_rel_names.end())
+  return name_or_number(evdev_rel_cname(code), "REL_#", code);
+}
+
+bool evdev_lookup_code(const char* name, size_t len, uint16_t& type, uint16_t& code)
+{
+  const size_t num_seeds = sizeof(name_hash_seeds) / sizeof(name_hash_seeds[0]);
+  const size_t num_entries = sizeof(name_hash_entries) / sizeof(name_hash_entries[0]);
+
+  const uint32_t seed = name_hash_seeds[name_hash(name, len, 0) % num_seeds];
+  const NameHashEntry& entry = name_hash_entries[name_hash(name, len, seed) % num_entries];
+
+  // the hash is only perfect for the names it was built from,
+  // anything else lands on an arbitrary entry
+  if (strncmp(entry.name, name, len) != 0 || entry.name[len] != '\0')
   {
-    std::ostringstream out;
-    out << "REL_#" << code;
-    return out.str();
+    return false;
   }
   else
   {
-    return it->second;
+    type = entry.type;
+    code = entry.code;
+    return true;
   }
 }
 
+bool evdev_lookup_code(const std::string& name, uint16_t& type, uint16_t& code)
+{
+  return evdev_lookup_code(name.data(), name.size(), type, code);
+}
+
 /* EOF */
@@ -14,15 +14,37 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+
 #ifndef HEADER_EVDEV_ENUM_HPP
 #define HEADER_EVDEV_ENUM_HPP
 
-#include "enum_box.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/** The name of a type or code, e.g. "EV_ABS" or "ABS_X", or nullptr
+    when the code has none. An array lookup into the tables that
+    gen_event_lists.py generates, so it is cheap enough to call for
+    every event and never allocates. */
+const char* evdev_type_cname(uint16_t type);
+const char* evdev_code_cname(uint16_t type, uint16_t code);
+const char* evdev_abs_cname(uint16_t code);
+const char* evdev_key_cname(uint16_t code);
+const char* evdev_rel_cname(uint16_t code);
 
+/** Like the above, but with a "ABS_#17" style fallback for unknown
+    codes */
 std::string evdev_abs_name(uint16_t code);
 std::string evdev_key_name(uint16_t code);
 std::string evdev_rel_name(uint16_t code);
 
+/** Resolves a SYN, KEY, BTN, REL, ABS, MSC, SW or LED name, aliases
+    like "BTN_A" included, to its type and code. A lookup in a perfect
+    hash that gen_event_lists.py generates, so it takes constant time
+    and never allocates. Returns false for unknown names. */
+bool evdev_lookup_code(const char* name, size_t len, uint16_t& type, uint16_t& code);
+bool evdev_lookup_code(const std::string& name, uint16_t& type, uint16_t& code);
+
 #endif
 
 /* EOF */
@@ -0,0 +1,162 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ctype.h>
+#include <iostream>
+#include <linux/input.h>
+#include <set>
+#include <string>
+#include <string.h>
+
+#include "evdev_enum.hpp"
+
+namespace {
+
+// the generated tables, the same ones evdev_enum.cpp is built from
+struct NameHashEntry
+{
+  const char* name;
+  uint16_t type;
+  uint16_t code;
+};
+
+#include "evdev_names.x"
+
+int g_failures = 0;
+
+void check(bool ok, const std::string& what)
+{
+  if (!ok)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    g_failures += 1;
+  }
+}
+
+/** Every name in the hash resolves to its own type and code */
+void test_hash_entries()
+{
+  for(const NameHashEntry& entry : name_hash_entries)
+  {
+    uint16_t type = 0xffff;
+    uint16_t code = 0xffff;
+    check(evdev_lookup_code(std::string(entry.name), type, code) &&
+          type == entry.type && code == entry.code,
+          std::string("lookup of ") + entry.name);
+  }
+}
+
+/** The names the code tables print resolve back to their code */
+template<size_t N>
+void test_table(const char* const (&names)[N], uint16_t type)
+{
+  for(size_t i = 0; i < N; ++i)
+  {
+    if (names[i])
+    {
+      uint16_t found_type;
+      uint16_t found_code;
+      check(evdev_lookup_code(std::string(names[i]), found_type, found_code) &&
+            found_type == type && found_code == i,
+            std::string("round trip of ") + names[i]);
+      const char* cname = evdev_code_cname(type, static_cast<uint16_t>(i));
+      check(cname && strcmp(cname, names[i]) == 0,
+            std::string("evdev_code_cname of ") + names[i]);
+    }
+  }
+}
+
+/** Strings close to real names only resolve when they are real names
+    themselves */
+void test_non_names()
+{
+  std::set<std::string> names;
+  for(const NameHashEntry& entry : name_hash_entries)
+  {
+    names.insert(entry.name);
+  }
+
+  for(const NameHashEntry& entry : name_hash_entries)
+  {
+    const std::string name = entry.name;
+    std::string lower = name;
+    for(char& c : lower)
+    {
+      c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+
+    for(const std::string& candidate : { name.substr(0, name.size() - 1), name + "X", name + "_",
+                                         "X" + name, lower, name + " " })
+    {
+      uint16_t type;
+      uint16_t code;
+      const bool found = evdev_lookup_code(candidate, type, code);
+      check(found == (names.count(candidate) != 0), "lookup of '" + candidate + "'");
+    }
+  }
+
+  for(const char* name : { "", "_", "KEY", "KEY_", "BTN_", "EV_KEY", "EV_ABS", "ABS_MT_",
+                           "KEY_RESERVEDX", "SND_CLICK", "REP_DELAY", "ABS_#17", "\xff\xfe" })
+  {
+    uint16_t type;
+    uint16_t code;
+    check(!evdev_lookup_code(std::string(name), type, code), std::string("lookup of '") + name + "'");
+  }
+
+  // only the first len characters count
+  uint16_t type;
+  uint16_t code;
+  check(evdev_lookup_code("ABS_XY", 5, type, code) && type == EV_ABS && code == ABS_X,
+        "lookup of a prefix");
+  check(!evdev_lookup_code("ABS_X", 4, type, code), "lookup of a prefix of a name");
+}
+
+void test_aliases()
+{
+  uint16_t type;
+  uint16_t code;
+  check(evdev_lookup_code(std::string("BTN_A"), type, code) && type == EV_KEY && code == BTN_SOUTH,
+        "BTN_A is BTN_SOUTH");
+  check(evdev_lookup_code(std::string("KEY_MIN_INTERESTING"), type, code) && code == KEY_MUTE,
+        "KEY_MIN_INTERESTING is KEY_MUTE");
+}
+
+} // namespace
+
+int main()
+{
+  test_hash_entries();
+  test_table(syn_names, EV_SYN);
+  test_table(key_names, EV_KEY);
+  test_table(rel_names, EV_REL);
+  test_table(abs_names, EV_ABS);
+  test_table(msc_names, EV_MSC);
+  test_table(sw_names, EV_SW);
+  test_table(led_names, EV_LED);
+  test_non_names();
+  test_aliases();
+
+  if (g_failures)
+  {
+    std::cerr << g_failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "all checks passed" << std::endl;
+  return 0;
+}
+
+/* EOF */
@@ -16,4 +16,7 @@
 
 #include "evdev_info.hpp"
 
+const size_t EvdevInfo::npos;
+const uint16_t EvdevInfo::no_idx;
+
 /* EOF */
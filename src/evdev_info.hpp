@@ -19,7 +19,7 @@
 
 #include <assert.h>
 #include <algorithm>
-#include <map>
+#include <memory>
 #include <vector>
 #include <array>
 #include <string>
@@ -27,6 +27,7 @@
 #include <stdexcept>
 
 #include "bits.hpp"
+#include "memory_usage.hpp"
 
 class AbsInfo
 {
@@ -59,6 +60,9 @@ public:
   }
 };
 
+/** The capabilities of a device. Once read it doesn't change anymore,
+    so the states, widgets, recorders and caches of a device all share
+    a single EvdevInfoPtr instead of copying it. */
 class EvdevInfo
 {
 public:
@@ -71,12 +75,24 @@ public:
   std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit;
   std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit;
 
-  std::map<uint16_t, AbsInfo> absinfos;
+  // indexed by code, only the entries in abss are valid
+  std::array<AbsInfo, ABS_CNT> absinfos;
 
   std::vector<uint16_t> abss;
   std::vector<uint16_t> rels;
   std::vector<uint16_t> keys;
 
+  /** Marks codes that the device doesn't support */
+  static const size_t npos = static_cast<size_t>(-1);
+
+private:
+  // code -> index into abss/rels/keys, no_idx when not supported,
+  // 16 bit as there are at most KEY_CNT of them
+  static const uint16_t no_idx = 0xffff;
+  std::array<uint16_t, ABS_CNT> m_abs_idx;
+  std::array<uint16_t, REL_CNT> m_rel_idx;
+  std::array<uint16_t, KEY_CNT> m_key_idx;
+
 public:
   EvdevInfo() :
     version(),
@@ -90,8 +106,14 @@ public:
     absinfos(),
     abss(),
     rels(),
-    keys()
+    keys(),
+    m_abs_idx(),
+    m_rel_idx(),
+    m_key_idx()
   {
+    m_abs_idx.fill(no_idx);
+    m_rel_idx.fill(no_idx);
+    m_key_idx.fill(no_idx);
   }
 
   EvdevInfo(int version_,
@@ -102,7 +124,7 @@ public:
             std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit_,
             std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit_,
             std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit_,
-            std::map<uint16_t, AbsInfo> absinfos_) :
+            const std::array<AbsInfo, ABS_CNT>& absinfos_) :
     version(version_),
     name(std::move(name_)),
     phys(std::move(phys_)),
@@ -111,15 +133,23 @@ public:
     abs_bit(std::move(abs_bit_)),
     rel_bit(std::move(rel_bit_)),
     key_bit(std::move(key_bit_)),
-    absinfos(std::move(absinfos_)),
+    absinfos(absinfos_),
     abss(),
     rels(),
-    keys()
+    keys(),
+    m_abs_idx(),
+    m_rel_idx(),
+    m_key_idx()
   {
+    m_abs_idx.fill(no_idx);
+    m_rel_idx.fill(no_idx);
+    m_key_idx.fill(no_idx);
+
     for(uint16_t i = 0; i < ABS_MAX; ++i)
     {
       if (bits::test_bit(i, abs_bit.data()))
       {
+        m_abs_idx[i] = static_cast<uint16_t>(abss.size());
         abss.push_back(i);
       }
     }
@@ -128,6 +158,7 @@ public:
     {
       if (bits::test_bit(i, rel_bit.data()))
       {
+        m_rel_idx[i] = static_cast<uint16_t>(rels.size());
         rels.push_back(i);
       }
     }
@@ -136,6 +167,7 @@ public:
     {
       if (bits::test_bit(i, key_bit.data()))
       {
+        m_key_idx[i] = static_cast<uint16_t>(keys.size());
         keys.push_back(i);
       }
     }
@@ -156,41 +188,52 @@ public:
     return bits::test_bit(code, rel_bit.data());
   }
 
+  /** Returns the index of \a code in keys, or npos if the device
+      doesn't have that key */
   size_t get_key_idx(uint16_t code) const
   {
-    auto it = std::find(keys.begin(), keys.end(), code);
-    assert(it != keys.end());
-    return static_cast<size_t>(it - keys.begin());
+    return (code < m_key_idx.size() && m_key_idx[code] != no_idx) ? m_key_idx[code] : npos;
   }
 
   size_t get_rel_idx(uint16_t code) const
   {
-    auto it = std::find(rels.begin(), rels.end(), code);
-    assert(it != rels.end());
-    return static_cast<size_t>(it - rels.begin());
+    return (code < m_rel_idx.size() && m_rel_idx[code] != no_idx) ? m_rel_idx[code] : npos;
   }
 
   size_t get_abs_idx(uint16_t code) const
   {
-    auto it = std::find(abss.begin(), abss.end(), code);
-    assert(it != abss.end());
-    return static_cast<size_t>(it - abss.begin());
+    return (code < m_abs_idx.size() && m_abs_idx[code] != no_idx) ? m_abs_idx[code] : npos;
   }
 
-  AbsInfo get_absinfo(uint16_t code) const
+  const AbsInfo& get_absinfo(uint16_t code) const
   {
-    auto it = absinfos.find(code);
-    if (it == absinfos.end())
+    if (code >= absinfos.size() || !has_abs(code))
     {
       throw std::runtime_error("invalid code");
     }
     else
     {
-      return it->second;
+      return absinfos[code];
     }
   }
+
+  /** The memory held by the EvdevInfo, counted as allocated on its
+      own as it is meant to be shared through an EvdevInfoPtr */
+  MemoryUsage get_memory_usage() const
+  {
+    MemoryUsage usage;
+    usage.add_object(sizeof(EvdevInfo));
+    usage.add(name);
+    usage.add(phys);
+    usage.add(abss);
+    usage.add(rels);
+    usage.add(keys);
+    return usage;
+  }
 };
 
+typedef std::shared_ptr<const EvdevInfo> EvdevInfoPtr;
+
 #endif
 
 /* EOF */
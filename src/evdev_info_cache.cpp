@@ -0,0 +1,87 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "evdev_info_cache.hpp"
+
+EvdevInfoCache::EvdevInfoCache() :
+  m_mutex(),
+  m_entries(),
+  m_hits(0),
+  m_misses(0)
+{
+}
+
+EvdevInfoPtr
+EvdevInfoCache::get(EvdevDevice& device)
+{
+  EvdevIdentity identity = device.read_identity();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(device.get_filename());
+    if (it != m_entries.end() && it->second.identity == identity)
+    {
+      m_hits += 1;
+      return it->second.info;
+    }
+  }
+
+  EvdevInfoPtr info = std::make_shared<const EvdevInfo>(device.read_evdev_info());
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_misses += 1;
+  Entry& entry = m_entries[device.get_filename()];
+  entry.identity = std::move(identity);
+  entry.info = info;
+  return info;
+}
+
+void
+EvdevInfoCache::erase(const std::string& filename)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.erase(filename);
+}
+
+void
+EvdevInfoCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+}
+
+unsigned long
+EvdevInfoCache::get_hits() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_hits;
+}
+
+unsigned long
+EvdevInfoCache::get_misses() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_misses;
+}
+
+size_t
+EvdevInfoCache::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+/* EOF */
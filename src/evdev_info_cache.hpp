@@ -0,0 +1,73 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_EVDEV_INFO_CACHE_HPP
+#define HEADER_EVDEV_INFO_CACHE_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "evdev_device.hpp"
+#include "evdev_info.hpp"
+
+/** Caches the result of EvdevDevice::read_evdev_info() per device
+    node, a device is only probed again when its EvdevIdentity
+    changed, i.e. the node got reused by a different device. Safe to
+    use from several threads, the devices are probed unlocked. */
+class EvdevInfoCache
+{
+private:
+  struct Entry
+  {
+    EvdevIdentity identity;
+    EvdevInfoPtr info;
+
+    Entry() :
+      identity(),
+      info()
+    {}
+  };
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, Entry> m_entries;
+  unsigned long m_hits;
+  unsigned long m_misses;
+
+public:
+  EvdevInfoCache();
+
+  /** Returns the capabilities of \a device, probing it if it isn't
+      in the cache or its identity changed, all users of a cached
+      device share the same EvdevInfo */
+  EvdevInfoPtr get(EvdevDevice& device);
+
+  /** Forget the device at \a filename, e.g. after it got removed */
+  void erase(const std::string& filename);
+  void clear();
+
+  unsigned long get_hits() const;
+  unsigned long get_misses() const;
+  size_t size() const;
+
+private:
+  EvdevInfoCache(const EvdevInfoCache&) = delete;
+  EvdevInfoCache& operator=(const EvdevInfoCache&) = delete;
+};
+
+#endif
+
+/* EOF */
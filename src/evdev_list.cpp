@@ -21,9 +21,45 @@
 #include <dirent.h>
 #include <stdexcept>
 #include <string.h>
-#include <fnmatch.h>
 #include <sstream>
 
+bool
+EvdevList::is_event_device(const char* name)
+{
+  if (strncmp(name, "event", 5) != 0 || name[5] == '\0')
+  {
+    return false;
+  }
+  else
+  {
+    for(const char* p = name + 5; *p != '\0'; ++p)
+    {
+      if (*p < '0' || *p > '9')
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+bool
+EvdevList::less(const std::string& lhs, const std::string& rhs)
+{
+  if (lhs.size() < rhs.size())
+  {
+    return true;
+  }
+  else if (lhs.size() > rhs.size())
+  {
+    return false;
+  }
+  else
+  {
+    return lhs < rhs;
+  }
+}
+
 std::vector<std::string>
 EvdevList::scan(const std::string& evdev_directory)
 {
@@ -39,8 +75,7 @@ EvdevList::scan(const std::string& evdev_directory)
     struct dirent* dentry;
     while((dentry = readdir(dirp)) != nullptr)
     {
-      if (fnmatch("event[0-9]", dentry->d_name, FNM_PATHNAME) == 0 ||
-          fnmatch("event[0-9][0-9]", dentry->d_name, FNM_PATHNAME) == 0)
+      if (is_event_device(dentry->d_name))
       {
         std::ostringstream str;
         str << evdev_directory << "/" << dentry->d_name;
@@ -49,23 +84,7 @@ EvdevList::scan(const std::string& evdev_directory)
     }
     closedir(dirp);
 
-    // numerical sort (i.e. event2 < event10)
-    std::sort(devices.begin(), devices.end(),
-              [](std::string const& lhs, std::string const& rhs) -> bool
-              {
-                if (lhs.size() < rhs.size())
-                {
-                  return true;
-                }
-                else if (lhs.size() > rhs.size())
-                {
-                  return false;
-                }
-                else
-                {
-                  return lhs < rhs;
-                }
-              });
+    std::sort(devices.begin(), devices.end(), &EvdevList::less);
 
     return devices;
   }
@@ -25,6 +25,12 @@ class EvdevList
 public:
   static std::vector<std::string> scan(const std::string& evdev_directory);
 
+  /** Returns true if \a name is of the form "event<N>" */
+  static bool is_event_device(const char* name);
+
+  /** Numerical order of the device nodes, i.e. event2 < event10 */
+  static bool less(const std::string& lhs, const std::string& rhs);
+
 private:
   EvdevList(const EvdevList&) = delete;
   EvdevList& operator=(const EvdevList&) = delete;
@@ -0,0 +1,304 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "evdev_prober.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+
+#include "evdev_info_cache.hpp"
+#include "latency_tracker.hpp"
+#include "util.hpp"
+
+class EvdevProber::Shared
+{
+public:
+  class Job
+  {
+  public:
+    std::string filename;
+    // when a worker picked it up, 0 while it is queued
+    uint64_t start_usec;
+
+    Job() :
+      filename(),
+      start_usec(0)
+    {}
+  };
+
+  std::mutex mutex;
+  std::condition_variable cond;
+
+  // queued and running probes by id, a probe that timed out is
+  // removed, so its worker knows to drop the result
+  std::map<uint64_t, Job> jobs;
+  std::deque<uint64_t> queue;
+  uint64_t next_id;
+
+  std::vector<std::unique_ptr<Result> > results;
+
+  size_t num_threads;
+  size_t num_idle;
+  // workers still busy with a probe that timed out
+  size_t num_stuck;
+  bool stop;
+
+  // wakes up the GUI thread when results are waiting
+  int wakeup_fd;
+
+  EvdevInfoCache info_cache;
+
+  Shared() :
+    mutex(),
+    cond(),
+    jobs(),
+    queue(),
+    next_id(1),
+    results(),
+    num_threads(0),
+    num_idle(0),
+    num_stuck(0),
+    stop(false),
+    wakeup_fd(-1),
+    info_cache()
+  {
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd < 0)
+    {
+      throw std::runtime_error(std::string("EvdevProber: ") + strerror(errno));
+    }
+  }
+
+  ~Shared()
+  {
+    close(wakeup_fd);
+  }
+
+  /** Called with the mutex held */
+  void push_result(std::unique_ptr<Result> result)
+  {
+    results.push_back(std::move(result));
+
+    uint64_t one = 1;
+    if (write(wakeup_fd, &one, sizeof(one)) < 0)
+    {
+      // counter is already non-zero, the GUI thread will wake up anyway
+    }
+  }
+
+  static void run(std::shared_ptr<Shared> shared);
+
+private:
+  Shared(const Shared&) = delete;
+  Shared& operator=(const Shared&) = delete;
+};
+
+void
+EvdevProber::Shared::run(std::shared_ptr<Shared> shared)
+{
+  std::unique_lock<std::mutex> lock(shared->mutex);
+  while(true)
+  {
+    shared->cond.wait(lock, [&shared]{ return shared->stop || !shared->queue.empty(); });
+    if (shared->stop)
+    {
+      return;
+    }
+
+    const uint64_t id = shared->queue.front();
+    shared->queue.pop_front();
+    Job& job = shared->jobs[id];
+    job.start_usec = LatencyTracker::now_usec();
+    shared->num_idle -= 1;
+
+    auto result = util::make_unique<Result>();
+    result->filename = job.filename;
+    const uint64_t start_usec = job.start_usec;
+    lock.unlock();
+
+    try
+    {
+      result->device = EvdevDevice::open(result->filename);
+      result->info = shared->info_cache.get(*result->device);
+      result->has_snapshot = result->device->read_snapshot(result->snapshot);
+    }
+    catch(const std::exception& err)
+    {
+      result->device.reset();
+      result->error = err.what();
+    }
+    result->usec = LatencyTracker::now_usec() - start_usec;
+
+    lock.lock();
+    shared->num_idle += 1;
+    // gone when the GUI thread already reported it as timed out
+    if (shared->jobs.erase(id))
+    {
+      shared->push_result(std::move(result));
+    }
+    else
+    {
+      shared->num_stuck -= 1;
+    }
+  }
+}
+
+EvdevProber::EvdevProber(int timeout_msec, size_t max_threads) :
+  m_shared(std::make_shared<Shared>()),
+  m_notifier(),
+  m_timeout_timer(),
+  m_timeout_msec(timeout_msec),
+  m_max_threads(max_threads)
+{
+  m_notifier = util::make_unique<QSocketNotifier>(m_shared->wakeup_fd, QSocketNotifier::Read);
+  QObject::connect(m_notifier.get(), SIGNAL(activated(int)),
+                   this, SLOT(on_wakeup(int)));
+
+  m_timeout_timer.setInterval(std::max(timeout_msec / 10, 10));
+  QObject::connect(&m_timeout_timer, SIGNAL(timeout()),
+                   this, SLOT(on_timeout_check()));
+}
+
+EvdevProber::~EvdevProber()
+{
+  m_notifier.reset();
+
+  {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    m_shared->stop = true;
+  }
+  m_shared->cond.notify_all();
+}
+
+void
+EvdevProber::probe(const std::string& filename)
+{
+  std::lock_guard<std::mutex> lock(m_shared->mutex);
+
+  for(const auto& it : m_shared->jobs)
+  {
+    if (it.second.filename == filename)
+    {
+      return;
+    }
+  }
+
+  const uint64_t id = m_shared->next_id++;
+  m_shared->jobs[id].filename = filename;
+  m_shared->queue.push_back(id);
+
+  // workers stuck in a timed out probe don't count against the
+  // limit, otherwise a few wedged devices would stall all others
+  if (m_shared->num_idle < m_shared->queue.size() &&
+      m_shared->num_threads - m_shared->num_stuck < m_max_threads)
+  {
+    m_shared->num_threads += 1;
+    m_shared->num_idle += 1;
+    std::thread(&Shared::run, m_shared).detach();
+  }
+  m_shared->cond.notify_one();
+
+  if (!m_timeout_timer.isActive())
+  {
+    m_timeout_timer.start();
+  }
+}
+
+bool
+EvdevProber::is_pending(const std::string& filename) const
+{
+  std::lock_guard<std::mutex> lock(m_shared->mutex);
+  for(const auto& it : m_shared->jobs)
+  {
+    if (it.second.filename == filename)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<std::unique_ptr<EvdevProber::Result> >
+EvdevProber::take_results()
+{
+  std::lock_guard<std::mutex> lock(m_shared->mutex);
+  std::vector<std::unique_ptr<Result> > results;
+  results.swap(m_shared->results);
+  return results;
+}
+
+EvdevInfoCache&
+EvdevProber::get_info_cache()
+{
+  return m_shared->info_cache;
+}
+
+void
+EvdevProber::on_wakeup(int fd)
+{
+  uint64_t value;
+  if (read(m_shared->wakeup_fd, &value, sizeof(value)) < 0)
+  {
+    // spurious wakeup, nothing to clear
+  }
+
+  sig_ready();
+}
+
+void
+EvdevProber::on_timeout_check()
+{
+  const uint64_t now = LatencyTracker::now_usec();
+  const uint64_t timeout_usec = static_cast<uint64_t>(m_timeout_msec) * 1000u;
+
+  std::lock_guard<std::mutex> lock(m_shared->mutex);
+  for(auto it = m_shared->jobs.begin(); it != m_shared->jobs.end();)
+  {
+    const Shared::Job& job = it->second;
+    if (job.start_usec != 0 && now - job.start_usec > timeout_usec)
+    {
+      auto result = util::make_unique<Result>();
+      result->filename = job.filename;
+      result->error = "probing timed out after " + std::to_string(m_timeout_msec) + " ms";
+      result->usec = now - job.start_usec;
+      m_shared->push_result(std::move(result));
+
+      m_shared->num_stuck += 1;
+      it = m_shared->jobs.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  if (m_shared->jobs.empty())
+  {
+    m_timeout_timer.stop();
+  }
+}
+
+/* EOF */
@@ -0,0 +1,119 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_EVDEV_PROBER_HPP
+#define HEADER_EVDEV_PROBER_HPP
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "evdev_device.hpp"
+#include "evdev_info.hpp"
+#include "evdev_snapshot.hpp"
+
+class EvdevInfoCache;
+
+/** Opens and probes device nodes on worker threads, so a slow device
+    (Bluetooth controllers can take hundreds of milliseconds per
+    ioctl) doesn't freeze the GUI and probing many devices takes as
+    long as the slowest one, not the sum of all of them. A probe that
+    takes longer than the timeout is reported as failed, its worker
+    is left to finish on its own while new workers take over the
+    queue. sig_ready is emitted once results are waiting in
+    take_results(). */
+class EvdevProber : public QObject
+{
+  Q_OBJECT
+
+public:
+  class Result
+  {
+  public:
+    std::string filename;
+    /** nullptr when the probe failed */
+    std::unique_ptr<EvdevDevice> device;
+    EvdevInfoPtr info;
+    EvdevSnapshot snapshot;
+    bool has_snapshot;
+    std::string error;
+    uint64_t usec;
+
+    Result() :
+      filename(),
+      device(),
+      info(),
+      snapshot(),
+      has_snapshot(false),
+      error(),
+      usec(0)
+    {}
+
+  private:
+    Result(const Result&) = delete;
+    Result& operator=(const Result&) = delete;
+  };
+
+private:
+  // shared with the workers, which may outlive the EvdevProber when
+  // they are stuck in a probe
+  class Shared;
+  std::shared_ptr<Shared> m_shared;
+
+  std::unique_ptr<QSocketNotifier> m_notifier;
+  QTimer m_timeout_timer;
+  int m_timeout_msec;
+  size_t m_max_threads;
+
+public:
+  /** Use at most \a max_threads workers, give up on a device after
+      \a timeout_msec */
+  EvdevProber(int timeout_msec = 2000, size_t max_threads = 8);
+  virtual ~EvdevProber();
+
+  /** Queue \a filename to be opened and probed, nothing happens when
+      it already is */
+  void probe(const std::string& filename);
+
+  bool is_pending(const std::string& filename) const;
+
+  /** The results that came in since the last call, in the order the
+      probes finished */
+  std::vector<std::unique_ptr<Result> > take_results();
+
+  /** Caches the EvdevInfo of every probed device */
+  EvdevInfoCache& get_info_cache();
+
+private slots:
+  void on_wakeup(int fd);
+  void on_timeout_check();
+
+signals:
+  void sig_ready();
+
+private:
+  EvdevProber(const EvdevProber&) = delete;
+  EvdevProber& operator=(const EvdevProber&) = delete;
+};
+
+#endif
+
+/* EOF */
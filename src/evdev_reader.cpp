@@ -0,0 +1,285 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "evdev_reader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <errno.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "event_source.hpp"
+#include "event_time.hpp"
+#include "latency_tracker.hpp"
+#include "util.hpp"
+
+EvdevReader::Channel::Channel(EventSource& source, LatencyTracker* latency, size_t capacity) :
+  m_source(source),
+  m_latency(latency),
+  m_resync(source),
+  m_filter(),
+  m_ring(capacity),
+  m_error(false)
+{
+}
+
+EvdevReader::EvdevReader(size_t capacity) :
+  m_capacity(capacity),
+  m_epoll_fd(-1),
+  m_wakeup_fd(-1),
+  m_stop_fd(-1),
+  m_mutex(),
+  m_channels(),
+  m_wakeup_requested(true),
+  m_notifier(),
+  m_frame_timer(),
+  m_thread()
+{
+  m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  m_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  // the stop fd is the only one registered without a Channel
+  struct epoll_event stop_ev;
+  stop_ev.events = EPOLLIN;
+  stop_ev.data.ptr = nullptr;
+
+  if (m_epoll_fd < 0 || m_wakeup_fd < 0 || m_stop_fd < 0 ||
+      epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &stop_ev) < 0)
+  {
+    int err = errno;
+    if (m_epoll_fd >= 0) close(m_epoll_fd);
+    if (m_wakeup_fd >= 0) close(m_wakeup_fd);
+    if (m_stop_fd >= 0) close(m_stop_fd);
+    throw std::runtime_error(std::string("EvdevReader: ") + strerror(err));
+  }
+
+  m_frame_timer.setSingleShot(true);
+  m_frame_timer.setTimerType(Qt::PreciseTimer);
+  QObject::connect(&m_frame_timer, SIGNAL(timeout()),
+                   this, SLOT(on_frame_timeout()));
+
+  m_notifier = util::make_unique<QSocketNotifier>(m_wakeup_fd, QSocketNotifier::Read);
+  QObject::connect(m_notifier.get(), SIGNAL(activated(int)),
+                   this, SLOT(on_wakeup(int)));
+
+  m_thread = std::thread(&EvdevReader::run, this);
+}
+
+EvdevReader::~EvdevReader()
+{
+  uint64_t one = 1;
+  if (write(m_stop_fd, &one, sizeof(one)) < 0)
+  {
+    // can't happen for an eventfd that is far from overflowing
+  }
+  m_thread.join();
+
+  m_notifier.reset();
+  close(m_epoll_fd);
+  close(m_wakeup_fd);
+  close(m_stop_fd);
+}
+
+EvdevReader::Channel&
+EvdevReader::add_device(EventSource& source, LatencyTracker* latency,
+                        const EvdevSnapshot* snapshot, const EventFilter* filter)
+{
+  auto channel = util::make_unique<Channel>(source, latency, m_capacity);
+  if (snapshot)
+  {
+    channel->m_resync.seed(*snapshot);
+  }
+  if (filter)
+  {
+    channel->m_filter = *filter;
+  }
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = channel.get();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, source.get_fd(), &ev) < 0)
+  {
+    throw std::runtime_error(std::string("epoll_ctl: ") + strerror(errno));
+  }
+  m_channels.push_back(std::move(channel));
+  return *m_channels.back();
+}
+
+void
+EvdevReader::remove_device(Channel& channel)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // fails with ENOENT when the reader thread already dropped the
+  // device after an error, which is fine
+  epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, channel.m_source.get_fd(), nullptr);
+
+  m_channels.erase(std::remove_if(m_channels.begin(), m_channels.end(),
+                                  [&channel](const std::unique_ptr<Channel>& c) {
+                                    return c.get() == &channel;
+                                  }),
+                   m_channels.end());
+}
+
+void
+EvdevReader::set_frame_rate(int hz)
+{
+  m_frame_timer.setInterval(hz > 0 ? 1000 / hz : 0);
+}
+
+void
+EvdevReader::wakeup()
+{
+  uint64_t one = 1;
+  if (write(m_wakeup_fd, &one, sizeof(one)) < 0)
+  {
+    // counter is already non-zero, the GUI thread will wake up anyway
+  }
+}
+
+void
+EvdevReader::run()
+{
+  std::array<struct epoll_event, 64> events;
+  std::array<struct input_event, 256> ev;
+  std::vector<struct input_event> out;
+  out.reserve(ev.size() * 2);
+
+  while(true)
+  {
+    int num_ready = epoll_wait(m_epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+    if (num_ready < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(size_t i = 0; i < static_cast<size_t>(num_ready); ++i)
+    {
+      Channel* channel = static_cast<Channel*>(events[i].data.ptr);
+      if (!channel)
+      {
+        return;
+      }
+
+      // the channel might have been removed since epoll_wait() returned
+      if (std::find_if(m_channels.begin(), m_channels.end(),
+                       [channel](const std::unique_ptr<Channel>& c) {
+                         return c.get() == channel;
+                       }) == m_channels.end())
+      {
+        continue;
+      }
+
+      if (events[i].events & (EPOLLERR | EPOLLHUP))
+      {
+        // stop polling it, epoll would report the error again forever
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, channel->m_source.get_fd(), nullptr);
+        channel->m_error = true;
+        continue;
+      }
+
+      ssize_t num_events;
+      do
+      {
+        num_events = channel->m_source.read_events(ev.data(), ev.size());
+        if (num_events > 0)
+        {
+          if (channel->m_latency)
+          {
+            const uint64_t now = LatencyTracker::now_usec();
+            for(size_t j = 0; j < static_cast<size_t>(num_events); ++j)
+            {
+              channel->m_latency->record(LatencyTracker::kRead, get_event_usec(ev[j]), now);
+            }
+          }
+
+          out.clear();
+          channel->m_resync.process(ev.data(), static_cast<size_t>(num_events), out);
+          if (!channel->m_filter.empty())
+          {
+            // after the resync, which has to see every event, and
+            // before the GUI thread spends any time on them
+            out.resize(channel->m_filter.filter(out.data(), out.size(), true));
+          }
+          if (channel->m_ring.push(out.data(), out.size()) < out.size())
+          {
+            // the GUI thread lost track of the device state
+            channel->m_resync.invalidate();
+          }
+        }
+        else if (num_events < 0)
+        {
+          epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, channel->m_source.get_fd(), nullptr);
+          channel->m_error = true;
+        }
+      }
+      // a short read means the kernel buffer is drained
+      while(num_events == static_cast<ssize_t>(ev.size()));
+    }
+
+    if (m_wakeup_requested.exchange(false))
+    {
+      wakeup();
+    }
+  }
+}
+
+void
+EvdevReader::on_wakeup(int fd)
+{
+  uint64_t value;
+  if (read(m_wakeup_fd, &value, sizeof(value)) < 0)
+  {
+    // spurious wakeup, nothing to clear
+  }
+
+  if (!m_frame_timer.isActive())
+  {
+    m_frame_timer.start();
+  }
+}
+
+void
+EvdevReader::on_frame_timeout()
+{
+  sig_ready();
+
+  // ask for the next wakeup before checking for leftovers, events
+  // pushed in between either trigger the wakeup or are seen here
+  m_wakeup_requested = true;
+  for(const auto& channel : m_channels)
+  {
+    if (!channel->m_ring.empty())
+    {
+      m_frame_timer.start();
+      break;
+    }
+  }
+}
+
+/* EOF */
@@ -0,0 +1,152 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_EVDEV_READER_HPP
+#define HEADER_EVDEV_READER_HPP
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <atomic>
+#include <linux/input.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "evdev_resync.hpp"
+#include "event_filter.hpp"
+#include "spsc_ring.hpp"
+
+class EventSource;
+class EvdevSnapshot;
+class LatencyTracker;
+
+/** Reads events from any number of EventSources on a separate thread
+    that serves all of them from a single epoll loop, so that a busy
+    GUI thread doesn't cause the kernel buffers to overflow. Each
+    device gets a Channel whose SpscRing hands the events over to the
+    GUI thread, sig_ready is emitted at most once per frame while
+    there is data to pop(). */
+class EvdevReader : public QObject
+{
+  Q_OBJECT
+
+public:
+  class Channel
+  {
+    friend class EvdevReader;
+
+  private:
+    EventSource& m_source;
+    LatencyTracker* m_latency;
+    EvdevResync m_resync;
+    EventFilter m_filter;
+    SpscRing<struct input_event> m_ring;
+    std::atomic<bool> m_error;
+
+  public:
+    Channel(EventSource& source, LatencyTracker* latency, size_t capacity);
+
+    /** GUI thread side, fetch up to \a count events from the ring */
+    size_t pop(struct input_event* ev, size_t count) { return m_ring.pop(ev, count); }
+
+    /** True when reading stopped because of an error, usually
+        because the device got unplugged */
+    bool has_error() const { return m_error.load(); }
+
+    EventSource& get_source() const { return m_source; }
+
+    size_t get_capacity() const { return m_ring.capacity(); }
+    size_t get_high_water_mark() const { return m_ring.get_high_water_mark(); }
+    uint64_t get_overflows() const { return m_ring.get_overflows(); }
+
+    /** SYN_DROPPED received from the kernel, events discarded with
+        them and the resyncs that replaced them */
+    uint64_t get_syn_dropped() const { return m_resync.get_syn_dropped(); }
+    uint64_t get_discarded() const { return m_resync.get_discarded(); }
+    uint64_t get_resyncs() const { return m_resync.get_resyncs(); }
+
+  private:
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+  };
+
+private:
+  size_t m_capacity;
+  int m_epoll_fd;
+
+  // eventfd the reader thread uses to wake up the GUI thread
+  int m_wakeup_fd;
+  // eventfd the GUI thread uses to stop the reader thread
+  int m_stop_fd;
+
+  // m_channels is only modified by the GUI thread, the mutex keeps
+  // the reader thread from using a Channel while it gets removed
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<Channel> > m_channels;
+
+  // set by the GUI thread once it drained the rings, so the reader
+  // thread only writes to m_wakeup_fd when somebody is waiting
+  std::atomic<bool> m_wakeup_requested;
+
+  std::unique_ptr<QSocketNotifier> m_notifier;
+  QTimer m_frame_timer;
+
+  std::thread m_thread;
+
+public:
+  /** \a capacity is the ring size of each Channel */
+  EvdevReader(size_t capacity = 8192);
+  virtual ~EvdevReader();
+
+  /** Start reading from \a source, the source must stay alive until
+      its Channel is passed to remove_device() or the reader is
+      destroyed. When \a latency is given, the time from the kernel
+      timestamp to read() is recorded into it. \a snapshot is the
+      state the consumer starts from, if it got one. Only events
+      passing \a filter and EV_SYN get pushed to the ring. */
+  Channel& add_device(EventSource& source, LatencyTracker* latency = nullptr,
+                      const EvdevSnapshot* snapshot = nullptr,
+                      const EventFilter* filter = nullptr);
+  void remove_device(Channel& channel);
+
+  size_t get_device_count() const { return m_channels.size(); }
+
+  /** Deliver sig_ready at most \a hz times per second, 0 delivers it
+      as soon as data arrives */
+  void set_frame_rate(int hz);
+
+private:
+  void run();
+  void wakeup();
+
+private slots:
+  void on_wakeup(int fd);
+  void on_frame_timeout();
+
+signals:
+  void sig_ready();
+
+private:
+  EvdevReader(const EvdevReader&) = delete;
+  EvdevReader& operator=(const EvdevReader&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,152 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "evdev_recorder.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string.h>
+#include <unistd.h>
+
+#include "evdev_info.hpp"
+
+namespace {
+
+bool write_all(int fd, const uint8_t* data, size_t len)
+{
+  while(len > 0)
+  {
+    ssize_t ret = ::write(fd, data, len);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    data += ret;
+    len -= static_cast<size_t>(ret);
+  }
+  return true;
+}
+
+} // namespace
+
+EvdevRecorder::EvdevRecorder(const std::string& filename, const EvdevInfo& info) :
+  m_fd(-1),
+  m_filename(filename),
+  m_encoder(),
+  m_buffer(),
+  m_mutex(),
+  m_cond(),
+  m_write_buffer(),
+  m_quit(false),
+  m_write_error(false),
+  m_event_count(0),
+  m_bytes(0),
+  m_thread()
+{
+  m_fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (m_fd < 0)
+  {
+    throw std::runtime_error(filename + ": " + strerror(errno));
+  }
+
+  std::vector<uint8_t> header;
+  recording::write_header(header, info);
+  if (!write_all(m_fd, header.data(), header.size()))
+  {
+    int err = errno;
+    close(m_fd);
+    throw std::runtime_error(filename + ": " + strerror(err));
+  }
+
+  m_buffer.reserve(buffer_size + 64);
+  m_write_buffer.reserve(buffer_size + 64);
+
+  m_thread = std::thread(&EvdevRecorder::run, this);
+}
+
+EvdevRecorder::~EvdevRecorder()
+{
+  flush();
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  m_cond.notify_one();
+  m_thread.join();
+
+  close(m_fd);
+}
+
+void
+EvdevRecorder::flush()
+{
+  if (m_buffer.empty())
+  {
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // only wait when the disk can't keep up at all, i.e. the previous
+    // buffer still isn't written
+    m_cond.wait(lock, [this]{ return m_write_buffer.empty(); });
+
+    m_bytes += m_buffer.size();
+    m_write_buffer.swap(m_buffer);
+  }
+  m_cond.notify_one();
+}
+
+void
+EvdevRecorder::run()
+{
+  std::vector<uint8_t> data;
+  data.reserve(buffer_size + 64);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while(true)
+  {
+    m_cond.wait(lock, [this]{ return m_quit || !m_write_buffer.empty(); });
+
+    if (m_write_buffer.empty())
+    {
+      return;
+    }
+
+    data.swap(m_write_buffer);
+    lock.unlock();
+    m_cond.notify_one();
+
+    if (!m_write_error && !write_all(m_fd, data.data(), data.size()))
+    {
+      m_write_error = true;
+      std::cerr << m_filename << ": " << strerror(errno) << std::endl;
+    }
+    data.clear();
+
+    lock.lock();
+  }
+}
+
+/* EOF */
@@ -0,0 +1,99 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_EVDEV_RECORDER_HPP
+#define HEADER_EVDEV_RECORDER_HPP
+
+#include <condition_variable>
+#include <linux/input.h>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "evdev_recording.hpp"
+
+class EvdevInfo;
+
+/** Writes a recording of a device's events, see evdev_recording.hpp
+    for the format. Events are encoded into a memory buffer, full
+    buffers are written to disk by a separate thread, so recording
+    never waits for the disk. */
+class EvdevRecorder
+{
+private:
+  int m_fd;
+  std::string m_filename;
+  recording::EventEncoder m_encoder;
+
+  // filled by record(), swapped with m_write_buffer once full
+  std::vector<uint8_t> m_buffer;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::vector<uint8_t> m_write_buffer;
+  bool m_quit;
+  bool m_write_error;
+
+  uint64_t m_event_count;
+  uint64_t m_bytes;
+
+  std::thread m_thread;
+
+public:
+  EvdevRecorder(const std::string& filename, const EvdevInfo& info);
+  ~EvdevRecorder();
+
+  void record(const struct input_event& ev)
+  {
+    m_encoder.encode(m_buffer, ev);
+    m_event_count += 1;
+    if (m_buffer.size() >= buffer_size)
+    {
+      flush();
+    }
+  }
+
+  void record(const struct input_event* ev, size_t count)
+  {
+    for(size_t i = 0; i < count; ++i)
+    {
+      record(ev[i]);
+    }
+  }
+
+  /** Hand the buffered events to the writer thread */
+  void flush();
+
+  uint64_t get_event_count() const { return m_event_count; }
+
+  /** Encoded size of the events, the header not included */
+  uint64_t get_bytes() const { return m_bytes + m_buffer.size(); }
+
+private:
+  static const size_t buffer_size = 256 * 1024;
+
+  void run();
+
+private:
+  EvdevRecorder(const EvdevRecorder&) = delete;
+  EvdevRecorder& operator=(const EvdevRecorder&) = delete;
+};
+
+#endif
+
+/* EOF */
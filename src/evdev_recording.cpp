@@ -0,0 +1,239 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "evdev_recording.hpp"
+
+#include <algorithm>
+
+#include "event_time.hpp"
+
+namespace recording {
+
+const char magic[8] = { 'E', 'V', 'T', 'Q', 'R', 'E', 'C', 1 };
+
+namespace {
+
+void put_string(std::vector<uint8_t>& out, const std::string& str)
+{
+  put_varint(out, str.size());
+  out.insert(out.end(), str.begin(), str.end());
+}
+
+template<size_t N>
+void put_bitmap(std::vector<uint8_t>& out, const std::array<unsigned long, N>& bitmap, size_t nbits)
+{
+  const size_t nbytes = (nbits + 7) / 8;
+  put_varint(out, nbytes);
+  for(size_t byte = 0; byte < nbytes; ++byte)
+  {
+    uint8_t v = 0;
+    for(size_t bit = 0; bit < 8; ++bit)
+    {
+      if (byte * 8 + bit < nbits && bits::test_bit(byte * 8 + bit, bitmap.data()))
+      {
+        v = static_cast<uint8_t>(v | (1u << bit));
+      }
+    }
+    out.push_back(v);
+  }
+}
+
+std::string get_string(const uint8_t*& p, const uint8_t* end)
+{
+  const uint64_t len = get_varint(p, end);
+  if (len > static_cast<uint64_t>(end - p))
+  {
+    throw std::runtime_error("recording: unexpected end of data");
+  }
+  std::string str(reinterpret_cast<const char*>(p), static_cast<size_t>(len));
+  p += len;
+  return str;
+}
+
+template<size_t N>
+std::array<unsigned long, N> get_bitmap(const uint8_t*& p, const uint8_t* end)
+{
+  std::array<unsigned long, N> bitmap{};
+
+  const uint64_t nbytes = get_varint(p, end);
+  if (nbytes > static_cast<uint64_t>(end - p))
+  {
+    throw std::runtime_error("recording: unexpected end of data");
+  }
+
+  for(size_t byte = 0; byte < nbytes; ++byte)
+  {
+    for(size_t bit = 0; bit < 8; ++bit)
+    {
+      const size_t nr = byte * 8 + bit;
+      if ((p[byte] >> bit) & 1 && nr < N * bits::bits_per_long)
+      {
+        bitmap[bits::long_idx(nr)] |= bits::bit(nr);
+      }
+    }
+  }
+  p += nbytes;
+
+  return bitmap;
+}
+
+int32_t get_int32(const uint8_t*& p, const uint8_t* end)
+{
+  return static_cast<int32_t>(unzigzag(get_varint(p, end)));
+}
+
+} // namespace
+
+void write_header(std::vector<uint8_t>& out, const EvdevInfo& info)
+{
+  out.insert(out.end(), magic, magic + sizeof(magic));
+
+  put_varint(out, static_cast<uint32_t>(info.version));
+  put_varint(out, info.id.bustype);
+  put_varint(out, info.id.vendor);
+  put_varint(out, info.id.product);
+  put_varint(out, info.id.version);
+  put_string(out, info.name);
+  put_string(out, info.phys);
+
+  put_bitmap(out, info.bit, EV_CNT);
+  put_bitmap(out, info.abs_bit, ABS_CNT);
+  put_bitmap(out, info.rel_bit, REL_CNT);
+  put_bitmap(out, info.key_bit, KEY_CNT);
+
+  put_varint(out, info.abss.size());
+  for(const auto code : info.abss)
+  {
+    const AbsInfo& absinfo = info.absinfos[code];
+    put_varint(out, code);
+    put_varint(out, zigzag(absinfo.value));
+    put_varint(out, zigzag(absinfo.minimum));
+    put_varint(out, zigzag(absinfo.maximum));
+    put_varint(out, zigzag(absinfo.fuzz));
+    put_varint(out, zigzag(absinfo.flat));
+    put_varint(out, zigzag(absinfo.resolution));
+  }
+}
+
+EvdevInfo read_header(const uint8_t*& p, const uint8_t* end)
+{
+  if (static_cast<size_t>(end - p) < sizeof(magic) ||
+      !std::equal(magic, magic + sizeof(magic), reinterpret_cast<const char*>(p)))
+  {
+    throw std::runtime_error("recording: not an evtest-qt recording");
+  }
+  p += sizeof(magic);
+
+  const int version = static_cast<int>(get_varint(p, end));
+
+  struct input_id id;
+  id.bustype = static_cast<uint16_t>(get_varint(p, end));
+  id.vendor = static_cast<uint16_t>(get_varint(p, end));
+  id.product = static_cast<uint16_t>(get_varint(p, end));
+  id.version = static_cast<uint16_t>(get_varint(p, end));
+
+  std::string name = get_string(p, end);
+  std::string phys = get_string(p, end);
+
+  auto bit = get_bitmap<bits::nbits(EV_MAX)>(p, end);
+  auto abs_bit = get_bitmap<bits::nbits(ABS_MAX)>(p, end);
+  auto rel_bit = get_bitmap<bits::nbits(REL_MAX)>(p, end);
+  auto key_bit = get_bitmap<bits::nbits(KEY_MAX)>(p, end);
+
+  std::array<AbsInfo, ABS_CNT> absinfos;
+  const uint64_t absinfo_count = get_varint(p, end);
+  for(uint64_t i = 0; i < absinfo_count; ++i)
+  {
+    const uint64_t code = get_varint(p, end);
+    if (code >= absinfos.size())
+    {
+      throw std::runtime_error("recording: invalid axis code");
+    }
+    AbsInfo& absinfo = absinfos[code];
+    absinfo.value = get_int32(p, end);
+    absinfo.minimum = get_int32(p, end);
+    absinfo.maximum = get_int32(p, end);
+    absinfo.fuzz = get_int32(p, end);
+    absinfo.flat = get_int32(p, end);
+    absinfo.resolution = get_int32(p, end);
+  }
+
+  return EvdevInfo(version, std::move(name), std::move(phys), id,
+                   bit, abs_bit, rel_bit, key_bit, absinfos);
+}
+
+void
+EventEncoder::encode(std::vector<uint8_t>& out, const struct input_event& ev)
+{
+  const uint64_t time = get_event_usec(ev);
+  const bool same_time = (time == m_last_time);
+
+  put_varint(out, static_cast<uint64_t>(ev.code) << 6 | (ev.type & 0x1fu) << 1 | (same_time ? 1 : 0));
+
+  if (!same_time)
+  {
+    const int64_t delta = static_cast<int64_t>(time - m_last_time);
+    put_varint(out, zigzag(delta - m_last_delta));
+    m_last_delta = delta;
+    m_last_time = time;
+  }
+
+  if (ev.type == EV_ABS && ev.code < m_abs_values.size())
+  {
+    put_varint(out, zigzag(static_cast<int64_t>(ev.value) - m_abs_values[ev.code]));
+    m_abs_values[ev.code] = ev.value;
+  }
+  else
+  {
+    put_varint(out, zigzag(ev.value));
+  }
+}
+
+bool
+EventDecoder::decode(const uint8_t*& p, const uint8_t* end, struct input_event& ev)
+{
+  if (p == end)
+  {
+    return false;
+  }
+
+  const uint64_t token = get_varint(p, end);
+  ev.type = static_cast<uint16_t>((token >> 1) & 0x1f);
+  ev.code = static_cast<uint16_t>(token >> 6);
+
+  if (!(token & 1))
+  {
+    m_last_delta += unzigzag(get_varint(p, end));
+    m_last_time += static_cast<uint64_t>(m_last_delta);
+  }
+  set_event_usec(ev, m_last_time);
+
+  if (ev.type == EV_ABS && ev.code < m_abs_values.size())
+  {
+    m_abs_values[ev.code] = static_cast<int32_t>(m_abs_values[ev.code] + unzigzag(get_varint(p, end)));
+    ev.value = m_abs_values[ev.code];
+  }
+  else
+  {
+    ev.value = get_int32(p, end);
+  }
+
+  return true;
+}
+
+} // namespace recording
+
+/* EOF */
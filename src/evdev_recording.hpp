@@ -0,0 +1,145 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_EVDEV_RECORDING_HPP
+#define HEADER_EVDEV_RECORDING_HPP
+
+#include <array>
+#include <linux/input.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "evdev_info.hpp"
+
+/*
+  Recording file format, all integers are LEB128 varints, signed
+  values are zigzag encoded first:
+
+    magic       "EVTQREC" followed by the format version byte
+    header      driver version, bustype, vendor, product, version,
+                name and phys (length + bytes), the EV/ABS/REL/KEY
+                bitmaps (length + bytes, bit N is bit N%8 of byte N/8),
+                the absinfo count followed by code, value, minimum,
+                maximum, fuzz, flat and resolution for each axis
+    events      until the end of the file:
+                  code << 6 | type << 1 | same_time
+                  unless same_time is set, the change of the time
+                  between events in usec, i.e. the difference of
+                  this and the previous time delta, so that a steady
+                  report rate encodes as zero
+                  value, for EV_ABS the delta to the previous value
+                  of the same axis
+
+  Events of the same frame share a timestamp, so most events only take
+  a byte for the code/type and one or two for the value.
+*/
+namespace recording {
+
+extern const char magic[8];
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t v)
+{
+  while(v >= 0x80)
+  {
+    out.push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+inline uint64_t zigzag(int64_t v)
+{
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v)
+{
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+/** Decodes a varint at \a p and advances it, throws
+    std::runtime_error when the data ends prematurely */
+inline uint64_t get_varint(const uint8_t*& p, const uint8_t* end)
+{
+  uint64_t v = 0;
+  for(unsigned shift = 0; shift < 64; shift += 7)
+  {
+    if (p == end)
+    {
+      throw std::runtime_error("recording: unexpected end of data");
+    }
+    const uint8_t byte = *p++;
+    v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+    {
+      return v;
+    }
+  }
+  throw std::runtime_error("recording: malformed varint");
+}
+
+/** Appends the magic and the header describing \a info to \a out */
+void write_header(std::vector<uint8_t>& out, const EvdevInfo& info);
+
+/** Parses the magic and the header at \a p and advances \a p to the
+    first event, throws std::runtime_error on malformed data */
+EvdevInfo read_header(const uint8_t*& p, const uint8_t* end);
+
+/** Keeps the state needed to delta encode a stream of events */
+class EventEncoder
+{
+private:
+  uint64_t m_last_time;
+  int64_t m_last_delta;
+  std::array<int32_t, ABS_CNT> m_abs_values;
+
+public:
+  EventEncoder() :
+    m_last_time(0),
+    m_last_delta(0),
+    m_abs_values()
+  {}
+
+  void encode(std::vector<uint8_t>& out, const struct input_event& ev);
+};
+
+/** The counterpart of EventEncoder */
+class EventDecoder
+{
+private:
+  uint64_t m_last_time;
+  int64_t m_last_delta;
+  std::array<int32_t, ABS_CNT> m_abs_values;
+
+public:
+  EventDecoder() :
+    m_last_time(0),
+    m_last_delta(0),
+    m_abs_values()
+  {}
+
+  /** Decodes the event at \a p into \a ev and advances \a p, returns
+      false when \a p is at the end of the data */
+  bool decode(const uint8_t*& p, const uint8_t* end, struct input_event& ev);
+};
+
+} // namespace recording
+
+#endif
+
+/* EOF */
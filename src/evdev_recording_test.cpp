@@ -0,0 +1,326 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string.h>
+#include <vector>
+
+#include "evdev_recording.hpp"
+#include "event_time.hpp"
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    g_failures += 1;
+  }
+}
+
+template<size_t N>
+void set_bit(std::array<unsigned long, N>& bitmap, size_t code)
+{
+  bitmap[bits::long_idx(code)] |= bits::bit(code);
+}
+
+EvdevInfo make_info()
+{
+  std::array<unsigned long, bits::nbits(EV_MAX)> bit{};
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit{};
+  std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit{};
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit{};
+  std::array<AbsInfo, ABS_CNT> absinfos;
+
+  for(size_t type : { EV_SYN, EV_KEY, EV_REL, EV_ABS, EV_MSC })
+  {
+    set_bit(bit, type);
+  }
+  for(size_t code : { BTN_SOUTH, BTN_TRIGGER_HAPPY40, KEY_MAX })
+  {
+    set_bit(key_bit, code);
+  }
+  for(size_t code : { REL_X, REL_WHEEL_HI_RES })
+  {
+    set_bit(rel_bit, code);
+  }
+
+  // every absinfo field with a sign and a magnitude of its own
+  const int32_t limit = std::numeric_limits<int32_t>::max();
+  const struct { uint16_t code; input_absinfo absinfo; } axes[] = {
+    { ABS_X, { 5, -32768, 32767, 16, 128, 1 } },
+    { ABS_BRAKE, { 10, 10, 255, 0, 0, 0 } },
+    { ABS_MT_POSITION_Y, { -7, -limit - 1, limit, 3, -4, 40 } },
+    { ABS_MAX, { 0, 0, 1, 0, 0, 0 } }
+  };
+  for(const auto& axis : axes)
+  {
+    set_bit(abs_bit, axis.code);
+    absinfos[axis.code] = AbsInfo(axis.absinfo);
+  }
+
+  input_id id{};
+  id.bustype = BUS_USB;
+  id.vendor = 0x045e;
+  id.product = 0x02ea;
+  id.version = 0xffff;
+  return EvdevInfo(0x10001, "Test Pad \xc3\xa9", "usb-0000:00:14.0-1/input0", id,
+                   bit, abs_bit, rel_bit, key_bit, absinfos);
+}
+
+struct input_event make_event(uint64_t usec, uint16_t type, uint16_t code, int32_t value)
+{
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  set_event_usec(ev, usec);
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  return ev;
+}
+
+std::vector<struct input_event> make_events()
+{
+  const int32_t max = std::numeric_limits<int32_t>::max();
+  const int32_t min = std::numeric_limits<int32_t>::min();
+  return {
+    make_event(1000000000000u, EV_ABS, ABS_X, 100),
+    make_event(1000000000000u, EV_KEY, BTN_SOUTH, 1),
+    make_event(1000000000000u, EV_MSC, MSC_SCAN, 0x90001),
+    make_event(1000000000000u, EV_SYN, SYN_REPORT, 0),
+    // a steady rate, then negative and extreme ABS deltas
+    make_event(1000000001000u, EV_ABS, ABS_X, -32768),
+    make_event(1000000001000u, EV_ABS, ABS_MT_POSITION_Y, max),
+    make_event(1000000001000u, EV_SYN, SYN_REPORT, 0),
+    make_event(1000000002000u, EV_ABS, ABS_MT_POSITION_Y, min),
+    make_event(1000000002000u, EV_ABS, ABS_X, 32767),
+    make_event(1000000002000u, EV_REL, REL_X, -120),
+    make_event(1000000002000u, EV_REL, REL_WHEEL_HI_RES, min),
+    make_event(1000000002000u, EV_SYN, SYN_REPORT, 0),
+    // the clock jumps backwards, then far forward
+    make_event(999999000000u, EV_KEY, BTN_SOUTH, 0),
+    make_event(999999000000u, EV_SYN, SYN_REPORT, 0),
+    make_event(999999000001u, EV_KEY, KEY_MAX, 2),
+    make_event(5000000000000u, EV_ABS, ABS_MAX, 1),
+    make_event(5000000000000u, EV_SYN, SYN_DROPPED, 0),
+    make_event(5000000000000u, EV_SYN, SYN_REPORT, 0),
+    make_event(0, EV_ABS, ABS_BRAKE, 10),
+    make_event(0, EV_SYN, SYN_REPORT, 0)
+  };
+}
+
+void check_header(const EvdevInfo& expected, const EvdevInfo& actual)
+{
+  check(actual.version == expected.version, "header: version");
+  check(actual.id.bustype == expected.id.bustype, "header: bustype");
+  check(actual.id.vendor == expected.id.vendor, "header: vendor");
+  check(actual.id.product == expected.id.product, "header: product");
+  check(actual.id.version == expected.id.version, "header: id version");
+  check(actual.name == expected.name, "header: name");
+  check(actual.phys == expected.phys, "header: phys");
+  check(actual.bit == expected.bit, "header: EV bits");
+  check(actual.abs_bit == expected.abs_bit, "header: ABS bits");
+  check(actual.rel_bit == expected.rel_bit, "header: REL bits");
+  check(actual.key_bit == expected.key_bit, "header: KEY bits");
+  check(actual.abss == expected.abss, "header: axes");
+  check(actual.rels == expected.rels, "header: rels");
+  check(actual.keys == expected.keys, "header: keys");
+
+  for(uint16_t code : expected.abss)
+  {
+    const AbsInfo& lhs = expected.absinfos[code];
+    const AbsInfo& rhs = actual.absinfos[code];
+    check(lhs.value == rhs.value, "header: absinfo value");
+    check(lhs.minimum == rhs.minimum, "header: absinfo minimum");
+    check(lhs.maximum == rhs.maximum, "header: absinfo maximum");
+    check(lhs.fuzz == rhs.fuzz, "header: absinfo fuzz");
+    check(lhs.flat == rhs.flat, "header: absinfo flat");
+    check(lhs.resolution == rhs.resolution, "header: absinfo resolution");
+  }
+}
+
+std::vector<uint8_t> encode(const EvdevInfo& info, const std::vector<struct input_event>& events)
+{
+  std::vector<uint8_t> data;
+  recording::write_header(data, info);
+  recording::EventEncoder encoder;
+  for(const auto& ev : events)
+  {
+    encoder.encode(data, ev);
+  }
+  return data;
+}
+
+void test_round_trip()
+{
+  const EvdevInfo info = make_info();
+  const std::vector<struct input_event> events = make_events();
+  const std::vector<uint8_t> data = encode(info, events);
+
+  const uint8_t* p = data.data();
+  const uint8_t* const end = data.data() + data.size();
+  check_header(info, recording::read_header(p, end));
+
+  recording::EventDecoder decoder;
+  struct input_event ev;
+  for(const auto& expected : events)
+  {
+    if (!decoder.decode(p, end, ev))
+    {
+      check(false, "events: recording ends early");
+      return;
+    }
+    check(ev.type == expected.type, "events: type");
+    check(ev.code == expected.code, "events: code");
+    check(ev.value == expected.value, "events: value");
+    check(get_event_usec(ev) == get_event_usec(expected), "events: time");
+  }
+  check(!decoder.decode(p, end, ev), "events: nothing after the last event");
+}
+
+void test_truncated()
+{
+  const EvdevInfo info = make_info();
+  std::vector<uint8_t> header;
+  recording::write_header(header, info);
+
+  // every cut into the header is an error
+  for(size_t len = 0; len < header.size(); ++len)
+  {
+    const uint8_t* p = header.data();
+    try
+    {
+      recording::read_header(p, header.data() + len);
+      check(false, "truncated header accepted");
+    }
+    catch(const std::runtime_error&)
+    {
+    }
+  }
+
+  // a cut into the last event loses only that one
+  const std::vector<struct input_event> events = make_events();
+  std::vector<uint8_t> data = encode(info, events);
+  data.pop_back();
+
+  const uint8_t* p = data.data();
+  const uint8_t* const end = data.data() + data.size();
+  recording::read_header(p, end);
+  recording::EventDecoder decoder;
+  struct input_event ev;
+  size_t count = 0;
+  try
+  {
+    while(decoder.decode(p, end, ev))
+    {
+      count += 1;
+    }
+    check(false, "truncated event accepted");
+  }
+  catch(const std::runtime_error&)
+  {
+  }
+  check(count == events.size() - 1, "events before the truncated one decoded");
+}
+
+void test_invalid()
+{
+  {
+    std::vector<uint8_t> data;
+    recording::write_header(data, make_info());
+    data[0] = 'X';
+    const uint8_t* p = data.data();
+    try
+    {
+      recording::read_header(p, data.data() + data.size());
+      check(false, "bad magic accepted");
+    }
+    catch(const std::runtime_error&)
+    {
+    }
+  }
+
+  {
+    // an empty device with a single absinfo for a code past ABS_MAX
+    std::vector<uint8_t> data(recording::magic, recording::magic + sizeof(recording::magic));
+    for(int i = 0; i < 5; ++i)
+    {
+      recording::put_varint(data, 0); // version and input_id
+    }
+    for(int i = 0; i < 6; ++i)
+    {
+      recording::put_varint(data, 0); // name, phys and the bitmaps
+    }
+    recording::put_varint(data, 1);
+    recording::put_varint(data, ABS_CNT);
+    for(int i = 0; i < 6; ++i)
+    {
+      recording::put_varint(data, 0);
+    }
+
+    const uint8_t* p = data.data();
+    try
+    {
+      recording::read_header(p, data.data() + data.size());
+      check(false, "invalid axis code accepted");
+    }
+    catch(const std::runtime_error& err)
+    {
+      check(std::string(err.what()) == "recording: invalid axis code", "invalid axis code reported");
+    }
+  }
+
+  {
+    // a varint that never ends
+    const std::vector<uint8_t> data(11, 0xff);
+    const uint8_t* p = data.data();
+    recording::EventDecoder decoder;
+    struct input_event ev;
+    try
+    {
+      decoder.decode(p, data.data() + data.size(), ev);
+      check(false, "malformed varint accepted");
+    }
+    catch(const std::runtime_error&)
+    {
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  test_round_trip();
+  test_truncated();
+  test_invalid();
+
+  if (g_failures)
+  {
+    std::cerr << g_failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "all checks passed" << std::endl;
+  return 0;
+}
+
+/* EOF */
@@ -0,0 +1,223 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "evdev_registry.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#include "evdev_list.hpp"
+
+namespace {
+
+/** Without sysfs a device is only known by its node */
+bool stat_node(const std::string& filename, EvdevSysfs::Device& device)
+{
+  struct stat st;
+  if (stat(filename.c_str(), &st) < 0 || !S_ISCHR(st.st_mode))
+  {
+    return false;
+  }
+  else
+  {
+    device.filename = filename;
+    device.rdev = st.st_rdev;
+    return true;
+  }
+}
+
+} // namespace
+
+EvdevRegistry::EvdevRegistry(const EvdevSysfs& sysfs, const std::string& dev_dir,
+                             QObject* parent_) :
+  QObject(parent_),
+  m_sysfs(sysfs),
+  m_dev_dir(dev_dir),
+  m_entries(),
+  m_paths(),
+  m_order(),
+  m_generation(0)
+{
+}
+
+EvdevRegistry::~EvdevRegistry()
+{
+}
+
+void
+EvdevRegistry::scan()
+{
+  m_generation += 1;
+
+  for(auto& device : read_all())
+  {
+    touch(device);
+  }
+
+  while(!m_order.empty() && m_entries[m_order.back()].generation != m_generation)
+  {
+    // a copy, remove() destroys the entry
+    const std::string filename = m_entries[m_order.back()].device.filename;
+    remove(filename);
+  }
+}
+
+void
+EvdevRegistry::update(const QString& filename_)
+{
+  const std::string filename = filename_.toStdString();
+
+  EvdevSysfs::Device device;
+  if (read_one(filename, device))
+  {
+    touch(device);
+  }
+  else
+  {
+    remove(filename);
+  }
+}
+
+const EvdevSysfs::Device*
+EvdevRegistry::find(const std::string& filename) const
+{
+  auto path = m_paths.find(filename);
+  if (path == m_paths.end())
+  {
+    return nullptr;
+  }
+  else
+  {
+    return &m_entries.at(path->second).device;
+  }
+}
+
+std::vector<std::string>
+EvdevRegistry::get_filenames() const
+{
+  std::vector<std::string> filenames;
+  filenames.reserve(m_paths.size());
+  for(const auto& path : m_paths)
+  {
+    filenames.push_back(path.first);
+  }
+  std::sort(filenames.begin(), filenames.end(), &EvdevList::less);
+  return filenames;
+}
+
+void
+EvdevRegistry::touch(EvdevSysfs::Device& device)
+{
+  // the path got a new dev_t, the old device is gone
+  auto path = m_paths.find(device.filename);
+  if (path != m_paths.end() && path->second != device.rdev)
+  {
+    remove(device.filename);
+  }
+
+  auto it = m_entries.find(device.rdev);
+  if (it == m_entries.end())
+  {
+    Entry& entry = m_entries[device.rdev];
+    m_order.push_front(device.rdev);
+    entry.order = m_order.begin();
+    entry.generation = m_generation;
+    entry.device = std::move(device);
+    m_paths[entry.device.filename] = entry.device.rdev;
+
+    sig_device_added(QString::fromStdString(entry.device.filename));
+  }
+  else
+  {
+    Entry& entry = it->second;
+    m_order.splice(m_order.begin(), m_order, entry.order);
+    entry.generation = m_generation;
+
+    // same node number, but a different device behind it, a device
+    // that was only stat()ed has nothing to compare against
+    const bool changed = (!entry.device.input.empty() && !device.input.empty() &&
+                          (entry.device.input != device.input ||
+                           entry.device.info.name != device.info.name));
+
+    // the node got renamed, to everybody who knows it by its path
+    // that's a removal and an addition
+    const std::string old_filename = entry.device.filename;
+    const bool renamed = (old_filename != device.filename);
+    if (renamed)
+    {
+      m_paths.erase(old_filename);
+      m_paths[device.filename] = device.rdev;
+    }
+    entry.device = std::move(device);
+
+    if (renamed)
+    {
+      sig_device_removed(QString::fromStdString(old_filename));
+      sig_device_added(QString::fromStdString(entry.device.filename));
+    }
+    else if (changed)
+    {
+      sig_device_changed(QString::fromStdString(entry.device.filename));
+    }
+  }
+}
+
+void
+EvdevRegistry::remove(const std::string& filename)
+{
+  auto path = m_paths.find(filename);
+  if (path != m_paths.end())
+  {
+    auto it = m_entries.find(path->second);
+    m_order.erase(it->second.order);
+    m_entries.erase(it);
+    m_paths.erase(path);
+
+    sig_device_removed(QString::fromStdString(filename));
+  }
+}
+
+std::vector<EvdevSysfs::Device>
+EvdevRegistry::read_all() const
+{
+  try
+  {
+    return m_sysfs.scan();
+  }
+  catch(const std::exception& err)
+  {
+    std::vector<EvdevSysfs::Device> devices;
+    for(const auto& filename : EvdevList::scan(m_dev_dir))
+    {
+      EvdevSysfs::Device device;
+      if (stat_node(filename, device))
+      {
+        devices.push_back(std::move(device));
+      }
+    }
+    return devices;
+  }
+}
+
+bool
+EvdevRegistry::read_one(const std::string& filename, EvdevSysfs::Device& device) const
+{
+  return m_sysfs.read(filename, device) || stat_node(filename, device);
+}
+
+/* EOF */
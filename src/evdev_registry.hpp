@@ -0,0 +1,113 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_EVDEV_REGISTRY_HPP
+#define HEADER_EVDEV_REGISTRY_HPP
+
+#include <QObject>
+#include <QString>
+
+#include <list>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+#include "evdev_sysfs.hpp"
+
+/** The event devices currently present, keyed by the dev_t of their
+    node and told apart by the input device behind it, so a node
+    number reused by a different device between two scans shows up as
+    changed instead of going unnoticed. Fed by full scans or by single
+    hotplug notifications, each added, removed or changed device costs
+    O(1) and is published through the signals right away. */
+class EvdevRegistry : public QObject
+{
+  Q_OBJECT
+
+private:
+  class Entry
+  {
+  public:
+    EvdevSysfs::Device device;
+    uint64_t generation;
+    // position in m_order
+    std::list<dev_t>::iterator order;
+
+    Entry() :
+      device(),
+      generation(0),
+      order()
+    {}
+  };
+
+  const EvdevSysfs& m_sysfs;
+  std::string m_dev_dir;
+
+  std::unordered_map<dev_t, Entry> m_entries;
+  std::unordered_map<std::string, dev_t> m_paths;
+
+  // most recently seen first, after a scan the devices that are gone
+  // are the ones at the back that it didn't touch
+  std::list<dev_t> m_order;
+  uint64_t m_generation;
+
+public:
+  /** \a dev_dir is scanned when \a sysfs isn't available, without
+      sysfs only the dev_t identifies a device */
+  EvdevRegistry(const EvdevSysfs& sysfs, const std::string& dev_dir = "/dev/input",
+                QObject* parent = nullptr);
+  virtual ~EvdevRegistry();
+
+  /** Rescan all devices and publish what changed since the last
+      scan */
+  void scan();
+
+  /** The device at \a filename, nullptr when there is none */
+  const EvdevSysfs::Device* find(const std::string& filename) const;
+
+  /** The device nodes sorted by their number */
+  std::vector<std::string> get_filenames() const;
+
+  size_t size() const { return m_entries.size(); }
+
+public slots:
+  /** Look at the single node \a filename again, e.g. after inotify
+      reported it */
+  void update(const QString& filename);
+
+private:
+  void touch(EvdevSysfs::Device& device);
+  void remove(const std::string& filename);
+  std::vector<EvdevSysfs::Device> read_all() const;
+  bool read_one(const std::string& filename, EvdevSysfs::Device& device) const;
+
+signals:
+  void sig_device_added(const QString& device);
+  void sig_device_removed(const QString& device);
+
+  /** The node now belongs to a different device than before */
+  void sig_device_changed(const QString& device);
+
+private:
+  EvdevRegistry(const EvdevRegistry&) = delete;
+  EvdevRegistry& operator=(const EvdevRegistry&) = delete;
+};
+
+#endif
+
+/* EOF */
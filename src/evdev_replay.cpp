@@ -0,0 +1,191 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "evdev_replay.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include "event_time.hpp"
+#include "evdev_snapshot.hpp"
+#include "evdev_state.hpp"
+
+namespace {
+
+std::vector<uint8_t> read_file(const std::string& filename)
+{
+  std::ifstream in(filename, std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error(filename + ": couldn't open recording");
+  }
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in),
+                              std::istreambuf_iterator<char>());
+}
+
+/** The device state at the start of the recording as far as the
+    header knows it, i.e. the absinfo value of every axis */
+EvdevSnapshot header_snapshot(const EvdevInfo& info)
+{
+  EvdevSnapshot snapshot;
+  snapshot.abs_bit = info.abs_bit;
+  for(uint16_t code : info.abss)
+  {
+    snapshot.abs_values[code] = info.absinfos[code].value;
+  }
+  return snapshot;
+}
+
+// events fed per timer tick when replaying as fast as possible, so
+// the GUI stays responsive
+const size_t fast_batch_size = 65536;
+
+} // namespace
+
+EvdevReplay::EvdevReplay(const std::string& filename) :
+  m_data(read_file(filename)),
+  m_pos(m_data.data()),
+  m_info(),
+  m_decoder(),
+  m_next(),
+  m_has_next(false),
+  m_state(nullptr),
+  m_speed(1.0),
+  m_timer(),
+  m_start_clock(),
+  m_start_time(0)
+{
+  m_info = std::make_shared<const EvdevInfo>(recording::read_header(m_pos, m_data.data() + m_data.size()));
+  m_has_next = fetch_next();
+
+  m_timer.setSingleShot(true);
+  m_timer.setTimerType(Qt::PreciseTimer);
+  QObject::connect(&m_timer, SIGNAL(timeout()),
+                   this, SLOT(on_timeout()));
+}
+
+EvdevReplay::~EvdevReplay()
+{
+}
+
+bool
+EvdevReplay::fetch_next()
+{
+  try
+  {
+    return m_decoder.decode(m_pos, m_data.data() + m_data.size(), m_next);
+  }
+  catch(const std::exception&)
+  {
+    // a truncated recording, e.g. from a crash, just ends early
+    m_pos = m_data.data() + m_data.size();
+    return false;
+  }
+}
+
+void
+EvdevReplay::set_speed(double speed)
+{
+  m_speed = speed;
+}
+
+void
+EvdevReplay::start(EvdevState& state)
+{
+  m_state = &state;
+  // the events only carry changes, start from the recorded values
+  // before the first one is due
+  m_state->set_snapshot(header_snapshot(*m_info));
+
+  m_start_clock = std::chrono::steady_clock::now();
+  m_start_time = m_has_next ? get_event_usec(m_next) : 0;
+  m_timer.start(0);
+}
+
+void
+EvdevReplay::stop()
+{
+  m_timer.stop();
+  m_state = nullptr;
+}
+
+size_t
+EvdevReplay::feed(EvdevState& state, size_t max_events)
+{
+  size_t count = 0;
+  while(m_has_next && count < max_events)
+  {
+    state.update(m_next);
+    m_has_next = fetch_next();
+    count += 1;
+  }
+  return count;
+}
+
+double
+EvdevReplay::since_start(const struct input_event& ev) const
+{
+  // signed, the recorded clock might have jumped backwards
+  return static_cast<double>(static_cast<int64_t>(get_event_usec(ev) - m_start_time));
+}
+
+void
+EvdevReplay::on_timeout()
+{
+  if (!m_state)
+  {
+    return;
+  }
+
+  if (m_speed <= 0.0)
+  {
+    feed(*m_state, fast_batch_size);
+  }
+  else
+  {
+    const double elapsed = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - m_start_clock).count() * m_speed;
+
+    while(m_has_next &&
+          since_start(m_next) <= elapsed)
+    {
+      m_state->update(m_next);
+      m_has_next = fetch_next();
+    }
+  }
+
+  if (!m_has_next)
+  {
+    m_state = nullptr;
+    sig_finished();
+  }
+  else if (m_speed <= 0.0)
+  {
+    m_timer.start(0);
+  }
+  else
+  {
+    // sleep until the next event is due
+    const double elapsed = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - m_start_clock).count() * m_speed;
+    const double due = since_start(m_next);
+    const double wait_msec = (due - elapsed) / m_speed / 1000.0;
+    m_timer.start(wait_msec > 0.0 ? static_cast<int>(wait_msec) : 0);
+  }
+}
+
+/* EOF */
@@ -0,0 +1,99 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_EVDEV_REPLAY_HPP
+#define HEADER_EVDEV_REPLAY_HPP
+
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+#include <linux/input.h>
+#include <string>
+#include <vector>
+
+#include "evdev_info.hpp"
+#include "evdev_recording.hpp"
+
+class EvdevState;
+
+/** Plays back a recording written by EvdevRecorder into an
+    EvdevState, either with the original timing, scaled in speed or
+    as fast as possible */
+class EvdevReplay : public QObject
+{
+  Q_OBJECT
+
+private:
+  std::vector<uint8_t> m_data;
+  const uint8_t* m_pos;
+  EvdevInfoPtr m_info;
+  recording::EventDecoder m_decoder;
+
+  struct input_event m_next;
+  bool m_has_next;
+
+  EvdevState* m_state;
+  double m_speed;
+  QTimer m_timer;
+
+  // wall clock and recording time at which playback started
+  std::chrono::steady_clock::time_point m_start_clock;
+  uint64_t m_start_time;
+
+public:
+  /** Loads \a filename, throws std::runtime_error when it isn't a
+      valid recording */
+  EvdevReplay(const std::string& filename);
+  virtual ~EvdevReplay();
+
+  /** The capabilities of the recorded device */
+  const EvdevInfoPtr& get_info() const { return m_info; }
+
+  /** 1.0 replays with the original timing, 2.0 twice as fast and so
+      on, 0 replays as fast as possible */
+  void set_speed(double speed);
+
+  /** Reset \a state to the axis values in the recording's header and
+      start feeding the events into it, sig_finished is emitted once
+      the recording is exhausted */
+  void start(EvdevState& state);
+  void stop();
+
+  /** Feed up to \a max_events events into \a state without any delay,
+      returns the number of events fed, 0 at the end of the recording */
+  size_t feed(EvdevState& state, size_t max_events);
+
+private:
+  bool fetch_next();
+
+  /** Recording time of \a ev relative to the start in usec */
+  double since_start(const struct input_event& ev) const;
+
+private slots:
+  void on_timeout();
+
+signals:
+  void sig_finished();
+
+private:
+  EvdevReplay(const EvdevReplay&) = delete;
+  EvdevReplay& operator=(const EvdevReplay&) = delete;
+};
+
+#endif
+
+/* EOF */
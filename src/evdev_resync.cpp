@@ -0,0 +1,287 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "evdev_resync.hpp"
+
+#include "event_source.hpp"
+
+namespace {
+
+// EVIOCGABS only reports the current slot of the MT axes, they are
+// resynced per slot from the EVIOCGMTSLOTS values instead
+bool is_mt_code(size_t code)
+{
+  return code >= ABS_MT_SLOT && code <= ABS_MT_TOOL_Y;
+}
+
+void set_bit(unsigned long* bitmap, size_t code, bool value)
+{
+  if (value)
+  {
+    bitmap[bits::long_idx(code)] |= bits::bit(code);
+  }
+  else
+  {
+    bitmap[bits::long_idx(code)] &= ~bits::bit(code);
+  }
+}
+
+void push_event(std::vector<struct input_event>& out, const struct input_event& syn,
+                uint16_t type, size_t code, int32_t value)
+{
+  struct input_event ev = syn;
+  ev.type = type;
+  ev.code = static_cast<uint16_t>(code);
+  ev.value = value;
+  out.push_back(ev);
+}
+
+/** Emit an event for every bit in \a seen or \a now that differs
+    from \a old, or for all of them when \a full */
+template<size_t N>
+void diff_bits(const std::array<unsigned long, N>& old, const std::array<unsigned long, N>& now,
+               const std::array<unsigned long, N>& seen, bool full, uint16_t type,
+               const struct input_event& syn, std::vector<struct input_event>& out)
+{
+  for(size_t i = 0; i < N; ++i)
+  {
+    unsigned long changed = full ? (seen[i] | now[i]) : (old[i] ^ now[i]);
+    while(changed)
+    {
+      const size_t bit = static_cast<size_t>(__builtin_ctzl(changed));
+      changed &= changed - 1;
+
+      const size_t code = i * bits::bits_per_long + bit;
+      push_event(out, syn, type, code, (now[i] >> bit) & 1);
+    }
+  }
+}
+
+/** Emit the ABS_MT_* events for every slot whose values in \a now
+    differ from \a old, or for all of them when \a full, each slot
+    preceded by an ABS_MT_SLOT, and select \a now's current slot again
+    afterwards */
+void diff_mt_slots(const EvdevSnapshot& old, const EvdevSnapshot& now, bool full,
+                   const struct input_event& syn, std::vector<struct input_event>& out)
+{
+  if (!now.has_abs(ABS_MT_SLOT))
+  {
+    return;
+  }
+
+  int32_t current_slot = old.abs_values[ABS_MT_SLOT];
+  for(size_t slot = 0; ; ++slot)
+  {
+    bool has_slot = false;
+    for(size_t i = 0; i < now.mt_values.size(); ++i)
+    {
+      const std::vector<int32_t>& values = now.mt_values[i];
+      if (slot >= values.size())
+      {
+        continue;
+      }
+      has_slot = true;
+
+      const std::vector<int32_t>& old_values = old.mt_values[i];
+      if (full || slot >= old_values.size() || old_values[slot] != values[slot])
+      {
+        if (current_slot != static_cast<int32_t>(slot))
+        {
+          current_slot = static_cast<int32_t>(slot);
+          push_event(out, syn, EV_ABS, ABS_MT_SLOT, current_slot);
+        }
+        push_event(out, syn, EV_ABS, ABS_MT_TOUCH_MAJOR + i, values[slot]);
+      }
+    }
+
+    if (!has_slot)
+    {
+      break;
+    }
+  }
+
+  if (full || current_slot != now.abs_values[ABS_MT_SLOT])
+  {
+    push_event(out, syn, EV_ABS, ABS_MT_SLOT, now.abs_values[ABS_MT_SLOT]);
+  }
+}
+
+template<size_t N>
+void merge_bits(std::array<unsigned long, N>& dst, const std::array<unsigned long, N>& src)
+{
+  for(size_t i = 0; i < N; ++i)
+  {
+    dst[i] |= src[i];
+  }
+}
+
+} // namespace
+
+EvdevResync::EvdevResync(EventSource& source) :
+  m_source(source),
+  m_shadow(),
+  m_seen(),
+  m_snapshot(),
+  m_dropping(false),
+  m_valid(true),
+  m_syn_dropped(0),
+  m_discarded(0),
+  m_resyncs(0)
+{
+}
+
+void
+EvdevResync::process(const struct input_event* ev, size_t count, std::vector<struct input_event>& out)
+{
+  for(size_t i = 0; i < count; ++i)
+  {
+    if (ev[i].type == EV_SYN && ev[i].code == SYN_DROPPED)
+    {
+      m_syn_dropped.fetch_add(1, std::memory_order_relaxed);
+      m_dropping = true;
+    }
+    else if (m_dropping)
+    {
+      if (ev[i].type == EV_SYN && ev[i].code == SYN_REPORT)
+      {
+        m_dropping = false;
+        resync(ev[i], out);
+      }
+      else
+      {
+        m_discarded.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    else
+    {
+      track(ev[i]);
+      out.push_back(ev[i]);
+    }
+  }
+}
+
+void
+EvdevResync::seed(const EvdevSnapshot& snapshot)
+{
+  m_shadow = snapshot;
+  m_seen = EvdevSnapshot();
+  merge_seen(snapshot);
+}
+
+void
+EvdevResync::merge_seen(const EvdevSnapshot& snapshot)
+{
+  merge_bits(m_seen.key_bit, snapshot.key_bit);
+  merge_bits(m_seen.abs_bit, snapshot.abs_bit);
+  merge_bits(m_seen.sw_bit, snapshot.sw_bit);
+  merge_bits(m_seen.led_bit, snapshot.led_bit);
+}
+
+void
+EvdevResync::invalidate()
+{
+  m_valid = false;
+  m_dropping = true;
+}
+
+void
+EvdevResync::track(const struct input_event& ev)
+{
+  switch(ev.type)
+  {
+    case EV_KEY:
+      if (ev.code < KEY_CNT)
+      {
+        set_bit(m_shadow.key_bit.data(), ev.code, ev.value != 0);
+        set_bit(m_seen.key_bit.data(), ev.code, true);
+      }
+      break;
+
+    case EV_ABS:
+      if (ev.code < ABS_CNT)
+      {
+        m_shadow.abs_values[ev.code] = ev.value;
+        set_bit(m_seen.abs_bit.data(), ev.code, true);
+
+        if (ev.code >= ABS_MT_TOUCH_MAJOR && ev.code <= ABS_MT_TOOL_Y)
+        {
+          // slots the shadow doesn't have get resynced in full anyway
+          std::vector<int32_t>& values = m_shadow.mt_values[ev.code - ABS_MT_TOUCH_MAJOR];
+          const int32_t slot = m_shadow.abs_values[ABS_MT_SLOT];
+          if (slot >= 0 && static_cast<size_t>(slot) < values.size())
+          {
+            values[static_cast<size_t>(slot)] = ev.value;
+          }
+        }
+      }
+      break;
+
+    case EV_SW:
+      if (ev.code < SW_CNT)
+      {
+        set_bit(m_shadow.sw_bit.data(), ev.code, ev.value != 0);
+        set_bit(m_seen.sw_bit.data(), ev.code, true);
+      }
+      break;
+
+    case EV_LED:
+      if (ev.code < LED_CNT)
+      {
+        set_bit(m_shadow.led_bit.data(), ev.code, ev.value != 0);
+        set_bit(m_seen.led_bit.data(), ev.code, true);
+      }
+      break;
+  }
+}
+
+void
+EvdevResync::resync(const struct input_event& syn, std::vector<struct input_event>& out)
+{
+  if (!m_source.read_snapshot(m_snapshot))
+  {
+    // nothing to resync from, pass the frame end on and hope for
+    // the best
+    out.push_back(syn);
+    return;
+  }
+
+  const bool full = !m_valid;
+
+  diff_bits(m_shadow.key_bit, m_snapshot.key_bit, m_seen.key_bit, full, EV_KEY, syn, out);
+
+  for(size_t code = 0; code < ABS_CNT; ++code)
+  {
+    if (bits::test_bit(code, m_snapshot.abs_bit.data()) && !is_mt_code(code) &&
+        (full || m_snapshot.abs_values[code] != m_shadow.abs_values[code]))
+    {
+      push_event(out, syn, EV_ABS, code, m_snapshot.abs_values[code]);
+    }
+  }
+
+  diff_mt_slots(m_shadow, m_snapshot, full, syn, out);
+
+  diff_bits(m_shadow.sw_bit, m_snapshot.sw_bit, m_seen.sw_bit, full, EV_SW, syn, out);
+  diff_bits(m_shadow.led_bit, m_snapshot.led_bit, m_seen.led_bit, full, EV_LED, syn, out);
+
+  out.push_back(syn);
+
+  m_shadow = m_snapshot;
+  merge_seen(m_snapshot);
+  m_valid = true;
+
+  m_resyncs.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* EOF */
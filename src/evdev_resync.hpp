@@ -0,0 +1,83 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HEADER_EVDEV_RESYNC_HPP
+#define HEADER_EVDEV_RESYNC_HPP
+
+#include <atomic>
+#include <linux/input.h>
+#include <vector>
+
+#include "evdev_snapshot.hpp"
+
+class EventSource;
+
+/** Recovers from SYN_DROPPED: the events up to the next SYN_REPORT
+    are discarded and replaced by the difference between a shadow of
+    the state that was passed on so far and a fresh EvdevSnapshot of
+    the device, so the consumer ends up with the actual device state
+    again. Used on the EvdevReader thread, the counters may be read
+    from any thread. */
+class EvdevResync
+{
+private:
+  EventSource& m_source;
+
+  // the state as seen by the consumer and the codes that ever got
+  // passed on, a full resync has to cover all of them
+  EvdevSnapshot m_shadow;
+  EvdevSnapshot m_seen;
+  EvdevSnapshot m_snapshot;
+
+  bool m_dropping;
+  // false when the consumer lost events the shadow doesn't know about
+  bool m_valid;
+
+  std::atomic<uint64_t> m_syn_dropped;
+  std::atomic<uint64_t> m_discarded;
+  std::atomic<uint64_t> m_resyncs;
+
+public:
+  EvdevResync(EventSource& source);
+
+  /** Start from \a snapshot instead of an all zero state, must
+      match what the consumer was given */
+  void seed(const EvdevSnapshot& snapshot);
+
+  /** Append \a count events to \a out, with dropped sequences
+      replaced by resync events */
+  void process(const struct input_event* ev, size_t count, std::vector<struct input_event>& out);
+
+  /** Events passed on by process() got lost downstream, e.g. in an
+      overflowing ring, resync the whole state at the next SYN_REPORT */
+  void invalidate();
+
+  uint64_t get_syn_dropped() const { return m_syn_dropped.load(std::memory_order_relaxed); }
+  uint64_t get_discarded() const { return m_discarded.load(std::memory_order_relaxed); }
+  uint64_t get_resyncs() const { return m_resyncs.load(std::memory_order_relaxed); }
+
+private:
+  void track(const struct input_event& ev);
+  void merge_seen(const EvdevSnapshot& snapshot);
+  void resync(const struct input_event& syn, std::vector<struct input_event>& out);
+
+private:
+  EvdevResync(const EvdevResync&) = delete;
+  EvdevResync& operator=(const EvdevResync&) = delete;
+};
+
+#endif
+
+/* EOF */
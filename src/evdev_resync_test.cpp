@@ -0,0 +1,327 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <iostream>
+#include <memory>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "evdev_resync.hpp"
+#include "evdev_snapshot.hpp"
+#include "evdev_state.hpp"
+#include "pipe_source.hpp"
+
+namespace {
+
+const size_t kNumSlots = 4;
+
+int g_failures = 0;
+
+void check(bool ok, const std::string& what)
+{
+  if (!ok)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    g_failures += 1;
+  }
+}
+
+template<size_t N>
+void set_bit(std::array<unsigned long, N>& bitmap, size_t code)
+{
+  bitmap[bits::long_idx(code)] |= bits::bit(code);
+}
+
+EvdevInfo make_touch_info()
+{
+  std::array<unsigned long, bits::nbits(EV_MAX)> bit{};
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit{};
+  std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit{};
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit{};
+  std::array<AbsInfo, ABS_CNT> absinfos;
+
+  set_bit(bit, EV_KEY);
+  set_bit(bit, EV_ABS);
+  set_bit(key_bit, BTN_TOUCH);
+  set_bit(abs_bit, ABS_X);
+  set_bit(abs_bit, ABS_MT_SLOT);
+  set_bit(abs_bit, ABS_MT_TRACKING_ID);
+  set_bit(abs_bit, ABS_MT_POSITION_X);
+
+  input_absinfo absinfo{};
+  absinfo.maximum = 1000;
+  absinfos[ABS_X] = AbsInfo(absinfo);
+  absinfos[ABS_MT_POSITION_X] = AbsInfo(absinfo);
+
+  absinfo.maximum = kNumSlots - 1;
+  absinfos[ABS_MT_SLOT] = AbsInfo(absinfo);
+
+  absinfo.minimum = -1;
+  absinfo.maximum = 65535;
+  absinfos[ABS_MT_TRACKING_ID] = AbsInfo(absinfo);
+
+  input_id id{};
+  return EvdevInfo(0, "pipe touchpad", "pipe/input0", id,
+                   bit, abs_bit, rel_bit, key_bit, absinfos);
+}
+
+/** What the device reports to EVIOCG*, all slots empty */
+EvdevSnapshot make_snapshot()
+{
+  EvdevSnapshot snapshot;
+  set_bit(snapshot.abs_bit, ABS_X);
+  set_bit(snapshot.abs_bit, ABS_MT_SLOT);
+  set_bit(snapshot.abs_bit, ABS_MT_TRACKING_ID);
+  set_bit(snapshot.abs_bit, ABS_MT_POSITION_X);
+  snapshot.mt_values[ABS_MT_TRACKING_ID - ABS_MT_TOUCH_MAJOR].assign(kNumSlots, -1);
+  snapshot.mt_values[ABS_MT_POSITION_X - ABS_MT_TOUCH_MAJOR].assign(kNumSlots, 0);
+  return snapshot;
+}
+
+void set_contact(EvdevSnapshot& snapshot, size_t slot, int32_t tracking_id, int32_t x)
+{
+  snapshot.mt_values[ABS_MT_TRACKING_ID - ABS_MT_TOUCH_MAJOR][slot] = tracking_id;
+  snapshot.mt_values[ABS_MT_POSITION_X - ABS_MT_TOUCH_MAJOR][slot] = x;
+}
+
+struct input_event make_event(uint16_t type, uint16_t code, int32_t value)
+{
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  return ev;
+}
+
+/** Read everything \a source has through \a resync, as EvdevReader
+    does, and return what got passed on */
+std::vector<struct input_event> pump(PipeSource& source, EvdevResync& resync)
+{
+  std::vector<struct input_event> out;
+  struct input_event ev[4];
+  ssize_t num_events;
+  while((num_events = source.read_events(ev, 4)) > 0)
+  {
+    resync.process(ev, static_cast<size_t>(num_events), out);
+  }
+  return out;
+}
+
+void apply(EvdevState& state, const std::vector<struct input_event>& events)
+{
+  for(const auto& ev : events)
+  {
+    state.update(ev);
+  }
+}
+
+bool equal(const std::vector<struct input_event>& lhs, const std::vector<struct input_event>& rhs)
+{
+  if (lhs.size() != rhs.size())
+  {
+    return false;
+  }
+
+  for(size_t i = 0; i < lhs.size(); ++i)
+  {
+    if (lhs[i].type != rhs[i].type || lhs[i].code != rhs[i].code || lhs[i].value != rhs[i].value)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool contains(const std::vector<struct input_event>& events, uint16_t type, uint16_t code)
+{
+  for(const auto& ev : events)
+  {
+    if (ev.type == type && ev.code == code)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** The consumer has to end up with exactly what the device has */
+void check_state(const EvdevState& state, const EvdevSnapshot& snapshot, const std::string& what)
+{
+  check(state.get_key_value(BTN_TOUCH) == (snapshot.has_key(BTN_TOUCH) ? 1 : 0), what + ": BTN_TOUCH");
+  check(state.get_abs_value(ABS_X) == snapshot.abs_values[ABS_X], what + ": ABS_X");
+  check(state.get_abs_value(ABS_MT_SLOT) == snapshot.abs_values[ABS_MT_SLOT], what + ": current slot");
+
+  const MultitouchSlots& mt_slots = state.get_mt_slots();
+  for(size_t slot = 0; slot < kNumSlots; ++slot)
+  {
+    for(int code : { ABS_MT_TRACKING_ID, ABS_MT_POSITION_X })
+    {
+      check(mt_slots.get(slot, static_cast<uint16_t>(code)) == snapshot.mt_values[code - ABS_MT_TOUCH_MAJOR][slot],
+            what + ": slot " + std::to_string(slot) + " code " + std::to_string(code));
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  PipeSource source("pipe-test", make_touch_info());
+  EvdevState state(std::make_shared<EvdevInfo>(source.read_evdev_info()));
+  // deliver every frame right away, there is no event loop
+  state.set_frame_rate(0);
+
+  EvdevResync resync(source);
+  EvdevSnapshot device = make_snapshot();
+  resync.seed(device);
+  state.set_snapshot(device);
+
+  // live events pass through untouched
+  const struct input_event touch[] = {
+    make_event(EV_ABS, ABS_MT_TRACKING_ID, 10),
+    make_event(EV_ABS, ABS_MT_POSITION_X, 100),
+    make_event(EV_KEY, BTN_TOUCH, 1),
+    make_event(EV_ABS, ABS_X, 100),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  source.write_events(touch, 5);
+  std::vector<struct input_event> out = pump(source, resync);
+  check(equal(out, std::vector<struct input_event>(touch, touch + 5)), "live frame passed on");
+  apply(state, out);
+  set_bit(device.key_bit, BTN_TOUCH);
+  device.abs_values[ABS_X] = 100;
+  set_contact(device, 0, 10, 100);
+  check_state(state, device, "live frame");
+
+  // events after SYN_DROPPED are discarded up to the SYN_REPORT, which
+  // gets replaced by the difference to what the device has by then:
+  // the first contact moved, a second one went down in slot 2, a
+  // switch got flipped on the way
+  const struct input_event dropped[] = {
+    make_event(EV_SYN, SYN_DROPPED, 0),
+    make_event(EV_ABS, ABS_X, 5),
+    make_event(EV_ABS, ABS_MT_SLOT, 3),
+    make_event(EV_ABS, ABS_MT_TRACKING_ID, 99),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  device.abs_values[ABS_X] = 300;
+  device.abs_values[ABS_MT_SLOT] = 2;
+  set_contact(device, 0, 10, 300);
+  set_contact(device, 2, 11, 50);
+  set_bit(device.sw_bit, SW_LID);
+  source.set_snapshot(device);
+  source.write_events(dropped, 5);
+  out = pump(source, resync);
+  const struct input_event diff[] = {
+    make_event(EV_ABS, ABS_X, 300),
+    make_event(EV_ABS, ABS_MT_POSITION_X, 300),
+    make_event(EV_ABS, ABS_MT_SLOT, 2),
+    make_event(EV_ABS, ABS_MT_POSITION_X, 50),
+    make_event(EV_ABS, ABS_MT_TRACKING_ID, 11),
+    make_event(EV_SW, SW_LID, 1),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  check(equal(out, std::vector<struct input_event>(diff, diff + 7)), "resync emits the difference");
+  check(resync.get_syn_dropped() == 1, "SYN_DROPPED counted");
+  check(resync.get_discarded() == 3, "events up to the SYN_REPORT discarded");
+  check(resync.get_resyncs() == 1, "resync counted");
+  apply(state, out);
+  check_state(state, device, "after SYN_DROPPED");
+
+  // only the slots that changed get touched, in code order, the
+  // current slot is selected again afterwards
+  const struct input_event dropped_again[] = {
+    make_event(EV_SYN, SYN_DROPPED, 0),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  device.abs_values[ABS_MT_SLOT] = 0;
+  set_contact(device, 1, 12, 70);
+  source.set_snapshot(device);
+  source.write_events(dropped_again, 2);
+  out = pump(source, resync);
+  const struct input_event slot_diff[] = {
+    make_event(EV_ABS, ABS_MT_SLOT, 1),
+    make_event(EV_ABS, ABS_MT_POSITION_X, 70),
+    make_event(EV_ABS, ABS_MT_TRACKING_ID, 12),
+    make_event(EV_ABS, ABS_MT_SLOT, 0),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  check(equal(out, std::vector<struct input_event>(slot_diff, slot_diff + 5)), "MT slots diffed per slot");
+  check(resync.get_discarded() == 3, "nothing to discard");
+  check(resync.get_resyncs() == 2, "second resync counted");
+  apply(state, out);
+  check_state(state, device, "after MT resync");
+
+  // a frame that was passed on but got lost before the consumer saw
+  // it, as in an overflowing ring: the shadow already knows it, so
+  // only a full resync can repair the consumer
+  const struct input_event lost[] = {
+    make_event(EV_ABS, ABS_MT_TRACKING_ID, -1),
+    make_event(EV_KEY, BTN_TOUCH, 0),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  source.write_events(lost, 3);
+  out = pump(source, resync);
+  check(out.size() == 3, "lost frame passed on");
+  resync.invalidate();
+
+  const struct input_event after_overflow[] = {
+    make_event(EV_ABS, ABS_X, 7),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  device.key_bit[bits::long_idx(BTN_TOUCH)] &= ~bits::bit(BTN_TOUCH);
+  set_contact(device, 0, -1, 300);
+  source.set_snapshot(device);
+  source.write_events(after_overflow, 2);
+  out = pump(source, resync);
+  check(resync.get_discarded() == 4, "events up to the SYN_REPORT discarded after invalidate()");
+  check(resync.get_resyncs() == 3, "full resync counted");
+  check(resync.get_syn_dropped() == 2, "invalidate() isn't a SYN_DROPPED");
+  check(contains(out, EV_KEY, BTN_TOUCH), "full resync covers unchanged keys");
+  check(contains(out, EV_ABS, ABS_X), "full resync covers unchanged axes");
+  check(contains(out, EV_SW, SW_LID), "full resync covers unchanged switches");
+  check(!out.empty() && out.back().type == EV_SYN && out.back().code == SYN_REPORT,
+        "full resync ends the frame");
+  apply(state, out);
+  check_state(state, device, "after invalidate()");
+
+  // without a snapshot there is nothing to diff against, only the
+  // frame end is passed on
+  {
+    PipeSource plain("pipe-plain", make_touch_info());
+    EvdevResync plain_resync(plain);
+    plain_resync.seed(make_snapshot());
+    plain.write_events(dropped, 5);
+    out = pump(plain, plain_resync);
+    check(out.size() == 1 && out[0].type == EV_SYN && out[0].code == SYN_REPORT,
+          "only the SYN_REPORT without a snapshot");
+    check(plain_resync.get_discarded() == 3, "events discarded without a snapshot");
+    check(plain_resync.get_resyncs() == 0, "no resync without a snapshot");
+  }
+
+  if (g_failures)
+  {
+    std::cerr << g_failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "all checks passed" << std::endl;
+  return 0;
+}
+
+/* EOF */
@@ -0,0 +1,65 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HEADER_EVDEV_SNAPSHOT_HPP
+#define HEADER_EVDEV_SNAPSHOT_HPP
+
+#include <array>
+#include <linux/input.h>
+#include <stdint.h>
+#include <vector>
+
+#include "bits.hpp"
+
+/** The complete state of a device at one point in time, as returned
+    by the EVIOCGKEY, EVIOCGABS, EVIOCGSW, EVIOCGLED and
+    EVIOCGMTSLOTS ioctls */
+class EvdevSnapshot
+{
+public:
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit;
+  // the axes that abs_values holds values for
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit;
+  std::array<int32_t, ABS_CNT> abs_values;
+  std::array<unsigned long, bits::nbits(SW_MAX)> sw_bit;
+  std::array<unsigned long, bits::nbits(LED_MAX)> led_bit;
+
+  // the ABS_MT_* axes of every MT slot, indexed by code -
+  // ABS_MT_TOUCH_MAJOR, empty for axes the device doesn't have
+  std::array<std::vector<int32_t>, ABS_MT_TOOL_Y - ABS_MT_TOUCH_MAJOR + 1> mt_values;
+
+  EvdevSnapshot() :
+    key_bit(),
+    abs_bit(),
+    abs_values(),
+    sw_bit(),
+    led_bit(),
+    mt_values()
+  {}
+
+  bool has_key(size_t code) const { return bits::test_bit(code, key_bit.data()); }
+  bool has_abs(size_t code) const { return bits::test_bit(code, abs_bit.data()); }
+
+  /** The number of MT slots for an ABS_MT_SLOT axis whose maximum is
+      \a maximum, capped so a bogus absinfo can't blow up the buffers */
+  static size_t get_num_mt_slots(int32_t maximum)
+  {
+    return maximum < 0 ? 0 : (maximum >= 256 ? 256 : static_cast<size_t>(maximum) + 1);
+  }
+};
+
+#endif
+
+/* EOF */
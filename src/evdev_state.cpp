@@ -16,99 +16,371 @@
 
 #include "evdev_state.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
-EvdevState::EvdevState(const EvdevInfo& info) :
-  m_info(info),
-  m_abs_values(info.abss.size(), 0),
-  m_rel_values(info.rels.size(), 0),
-  m_key_values(info.keys.size(), 0),
-  m_mt_states()
+#include "evdev_snapshot.hpp"
+#include "event_time.hpp"
+#include "latency_tracker.hpp"
+
+EvdevState::EvdevState(EvdevInfoPtr info, bool specialize) :
+  m_info(std::move(info)),
+  m_device_class(specialize ? DeviceClass::classify(*m_info) : DeviceClass::kGeneric),
+  m_update(),
+  m_abs_values(m_info->abss.size(), 0),
+  m_rel_values(m_info->rels.size(), 0),
+  m_key_values(m_info->keys.size(), 0),
+  m_mt_slots(*m_info),
+  m_mt_slot_idx(m_info->get_abs_idx(ABS_MT_SLOT)),
+  m_abs_min(m_info->abss.size(), std::numeric_limits<int32_t>::max()),
+  m_abs_max(m_info->abss.size(), std::numeric_limits<int32_t>::min()),
+  m_key_peak(m_info->keys.size(), 0),
+  m_dirty_keys(m_info->keys.size()),
+  m_dirty_abss(m_info->abss.size()),
+  m_dirty_rels(m_info->rels.size()),
+  m_frame_timer(),
+  m_frame_pending(false),
+  m_report_rate(),
+  m_dropping(false),
+  m_syn_dropped(0),
+  m_latency(),
+  m_frame_usec(0)
+{
+  switch(m_device_class)
+  {
+    case DeviceClass::kGamepad: m_update = &EvdevState::update_as<DeviceClass::kGamepad>; break;
+    case DeviceClass::kKeyboard: m_update = &EvdevState::update_as<DeviceClass::kKeyboard>; break;
+    case DeviceClass::kMouse: m_update = &EvdevState::update_as<DeviceClass::kMouse>; break;
+    case DeviceClass::kTouch: m_update = &EvdevState::update_as<DeviceClass::kTouch>; break;
+    case DeviceClass::kTablet: m_update = &EvdevState::update_as<DeviceClass::kTablet>; break;
+    default: m_update = &EvdevState::update_as<DeviceClass::kGeneric>; break;
+  }
+
+  // start from the values reported at probe time, the extremes stay
+  // empty, a resting position isn't a reached extreme
+  for(size_t i = 0; i < m_info->abss.size(); ++i)
+  {
+    m_abs_values[i] = m_info->absinfos[m_info->abss[i]].value;
+  }
+
+  m_frame_timer.setSingleShot(true);
+  m_frame_timer.setTimerType(Qt::PreciseTimer);
+  QObject::connect(&m_frame_timer, SIGNAL(timeout()),
+                   this, SLOT(on_frame_timeout()));
+
+  set_frame_rate(60);
+}
+
+MemoryUsage
+EvdevState::get_memory_usage() const
+{
+  MemoryUsage usage;
+  usage.add_object(sizeof(EvdevState));
+  usage.add(m_abs_values);
+  usage.add(m_rel_values);
+  usage.add(m_key_values);
+  usage.add(m_abs_min);
+  usage.add(m_abs_max);
+  usage.add(m_key_peak);
+  usage += m_dirty_keys.get_memory_usage();
+  usage += m_dirty_abss.get_memory_usage();
+  usage += m_dirty_rels.get_memory_usage();
+  usage += m_mt_slots.get_memory_usage();
+  return usage;
+}
+
+void
+EvdevState::set_frame_rate(int hz)
+{
+  m_frame_timer.setInterval(hz > 0 ? 1000 / hz : 0);
+
+  if (hz <= 0 && m_frame_timer.isActive())
+  {
+    m_frame_timer.stop();
+    if (m_frame_pending)
+    {
+      m_frame_pending = false;
+      emit_change();
+    }
+  }
+}
+
+void
+EvdevState::emit_change()
+{
+  if (m_dirty_keys.empty() && m_dirty_abss.empty() &&
+      m_dirty_rels.empty() && m_mt_slots.get_dirty_slots().empty())
+  {
+    m_frame_usec = 0;
+    return;
+  }
+
+  sig_change(*this);
+
+  if (m_latency && m_frame_usec != 0)
+  {
+    m_latency->dispatched(m_frame_usec, LatencyTracker::now_usec());
+    m_frame_usec = 0;
+  }
+
+  // start the next frame from the current values, only the controls
+  // that changed need to be touched
+  for(auto idx : m_dirty_rels.items())
+  {
+    m_rel_values[idx] = 0;
+  }
+
+  for(auto idx : m_dirty_abss.items())
+  {
+    clear_abs_extremes(idx);
+  }
+
+  for(auto idx : m_dirty_keys.items())
+  {
+    m_key_peak[idx] = m_key_values[idx];
+  }
+
+  m_dirty_keys.clear();
+  m_dirty_abss.clear();
+  m_dirty_rels.clear();
+  m_mt_slots.clear_dirty();
+}
+
+void
+EvdevState::on_frame_timeout()
+{
+  if (m_frame_pending)
+  {
+    m_frame_pending = false;
+    emit_change();
+    m_frame_timer.start();
+  }
+}
+
+void
+EvdevState::set_snapshot(const EvdevSnapshot& snapshot)
 {
-  if (info.has_abs(ABS_MT_SLOT))
+  for(size_t i = 0; i < m_info->keys.size(); ++i)
+  {
+    m_key_values[i] = snapshot.has_key(m_info->keys[i]) ? 1 : 0;
+    m_key_peak[i] = m_key_values[i];
+    m_dirty_keys.mark(i);
+  }
+
+  for(size_t i = 0; i < m_info->abss.size(); ++i)
   {
-    AbsInfo absinfo = info.get_absinfo(ABS_MT_SLOT);
-    assert(absinfo.minimum == 0);
-    m_mt_states.resize(static_cast<size_t>(absinfo.maximum + 1));
+    if (snapshot.has_abs(m_info->abss[i]))
+    {
+      m_abs_values[i] = snapshot.abs_values[m_info->abss[i]];
+      clear_abs_extremes(i);
+      m_dirty_abss.mark(i);
+    }
   }
+
+  // contacts that are already down show up right away, the current
+  // slot came with the ABS_MT_SLOT value above
+  m_mt_slots.set_snapshot(snapshot);
+
+  emit_change();
 }
 
 void
 EvdevState::update(const input_event& ev)
 {
+  if (m_latency)
+  {
+    const uint64_t event_usec = get_event_usec(ev);
+    m_latency->record(LatencyTracker::kUpdate, event_usec, LatencyTracker::now_usec());
+    if (m_frame_usec == 0)
+    {
+      m_frame_usec = event_usec;
+    }
+  }
+
+  if (m_dropping)
+  {
+    if (ev.type == EV_SYN && ev.code == SYN_REPORT)
+    {
+      m_dropping = false;
+    }
+    return;
+  }
+
+  (this->*m_update)(ev);
+}
+
+template<DeviceClass::Type T>
+void
+EvdevState::update_as(const input_event& ev)
+{
+  // the branches for the event types the class doesn't have are
+  // compiled out, the events get dropped like any other unsupported
+  // code would be
+  typedef DeviceClassTraits<T> Traits;
+
   switch(ev.type)
   {
     case EV_SYN:
-      sig_change(*this);
-
-      // clear rel values
-      for(auto& v : m_rel_values)
-      {
-        v = 0;
-      }
+      update_syn(ev);
       break;
 
     case EV_KEY:
-      m_key_values[m_info.get_key_idx(ev.code)] = ev.value;
+      if (Traits::keys != DeviceClass::kNo)
+      {
+        update_key(ev);
+      }
       break;
 
     case EV_ABS:
-      m_abs_values[m_info.get_abs_idx(ev.code)] = ev.value;
-
-      if (m_info.has_abs(ABS_MT_SLOT))
+      if (Traits::abss != DeviceClass::kNo)
       {
-        const int slot = m_abs_values[m_info.get_abs_idx(ABS_MT_SLOT)];
+        update_abs(ev);
 
-        if (ev.code == ABS_MT_POSITION_X)
-        {
-          m_mt_states[static_cast<size_t>(slot)].x = ev.value;
-        }
-        else if (ev.code == ABS_MT_POSITION_Y)
+        if (Traits::mt_slots == DeviceClass::kYes ||
+            (Traits::mt_slots == DeviceClass::kMaybe && m_mt_slot_idx != EvdevInfo::npos))
         {
-          m_mt_states[static_cast<size_t>(slot)].y = ev.value;
-        }
-        else if (ev.code == ABS_MT_TRACKING_ID)
-        {
-          m_mt_states[static_cast<size_t>(slot)].tracking_id = ev.value;
+          update_mt(ev);
         }
       }
       break;
 
     case EV_REL:
-      // rel values are accumulated until a EV_SYN event
-      m_rel_values[m_info.get_rel_idx(ev.code)] += ev.value;
+      if (Traits::rels != DeviceClass::kNo)
+      {
+        update_rel(ev);
+      }
       break;
   }
 }
 
+inline void
+EvdevState::update_syn(const input_event& ev)
+{
+  if (ev.code == SYN_DROPPED)
+  {
+    m_dropping = true;
+    m_syn_dropped += 1;
+    return;
+  }
+  else if (ev.code != SYN_REPORT)
+  {
+    return;
+  }
+
+  m_report_rate.add_report(get_event_usec(ev));
+
+  if (m_frame_timer.interval() == 0)
+  {
+    emit_change();
+  }
+  else if (m_frame_timer.isActive())
+  {
+    // a frame was emitted recently, deliver this one once the
+    // frame interval is over
+    m_frame_pending = true;
+  }
+  else
+  {
+    emit_change();
+    m_frame_timer.start();
+  }
+}
+
+inline void
+EvdevState::update_key(const input_event& ev)
+{
+  const size_t idx = m_info->get_key_idx(ev.code);
+  if (idx != EvdevInfo::npos)
+  {
+    m_key_values[idx] = ev.value;
+    m_key_peak[idx] = std::max(m_key_peak[idx], ev.value);
+    m_dirty_keys.mark(idx);
+  }
+}
+
+inline void
+EvdevState::update_abs(const input_event& ev)
+{
+  const size_t idx = m_info->get_abs_idx(ev.code);
+  if (idx != EvdevInfo::npos)
+  {
+    m_abs_values[idx] = ev.value;
+    m_abs_min[idx] = std::min(m_abs_min[idx], ev.value);
+    m_abs_max[idx] = std::max(m_abs_max[idx], ev.value);
+    m_dirty_abss.mark(idx);
+  }
+}
+
+void
+EvdevState::clear_abs_extremes(size_t idx)
+{
+  m_abs_min[idx] = std::numeric_limits<int32_t>::max();
+  m_abs_max[idx] = std::numeric_limits<int32_t>::min();
+}
+
+inline void
+EvdevState::update_rel(const input_event& ev)
+{
+  // rel values are accumulated until a EV_SYN event
+  const size_t idx = m_info->get_rel_idx(ev.code);
+  if (idx != EvdevInfo::npos)
+  {
+    m_rel_values[idx] += ev.value;
+    m_dirty_rels.mark(idx);
+  }
+}
+
+inline void
+EvdevState::update_mt(const input_event& ev)
+{
+  const int slot = m_abs_values[m_mt_slot_idx];
+  if (slot >= 0 && static_cast<size_t>(slot) < m_mt_slots.size())
+  {
+    m_mt_slots.set(static_cast<size_t>(slot), ev.code, ev.value);
+  }
+}
+
 int
 EvdevState::get_key_value(uint16_t code) const
 {
-  return m_key_values[m_info.get_key_idx(code)];
+  const size_t idx = m_info->get_key_idx(code);
+  return idx != EvdevInfo::npos ? m_key_values[idx] : 0;
 }
 
 int
 EvdevState::get_abs_value(uint16_t code) const
 {
-  return m_abs_values[m_info.get_abs_idx(code)];
+  const size_t idx = m_info->get_abs_idx(code);
+  return idx != EvdevInfo::npos ? m_abs_values[idx] : 0;
 }
 
 int
 EvdevState::get_rel_value(uint16_t code) const
 {
-  return m_rel_values[m_info.get_rel_idx(code)];
+  const size_t idx = m_info->get_rel_idx(code);
+  return idx != EvdevInfo::npos ? m_rel_values[idx] : 0;
 }
 
 int
-EvdevState::get_mt_slot_count() const
+EvdevState::get_abs_min(uint16_t code) const
 {
-  return static_cast<int>(m_mt_states.size());
+  const size_t idx = m_info->get_abs_idx(code);
+  return idx != EvdevInfo::npos ? m_abs_min[idx] : 0;
 }
 
-MultitouchState
-EvdevState::get_mt_state(int slot) const
+int
+EvdevState::get_abs_max(uint16_t code) const
+{
+  const size_t idx = m_info->get_abs_idx(code);
+  return idx != EvdevInfo::npos ? m_abs_max[idx] : 0;
+}
+
+int
+EvdevState::get_key_peak(uint16_t code) const
 {
-  return m_mt_states[static_cast<size_t>(slot)];
+  const size_t idx = m_info->get_key_idx(code);
+  return idx != EvdevInfo::npos ? m_key_peak[idx] : 0;
 }
 
 /* EOF */
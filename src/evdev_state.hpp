@@ -18,62 +18,149 @@
 #define HEADER_EVDEV_STATE_HPP
 
 #include <QObject>
+#include <QTimer>
 
 #include <stdint.h>
 #include <linux/input.h>
 #include <vector>
 
+#include "device_class.hpp"
+#include "dirty_set.hpp"
 #include "evdev_info.hpp"
+#include "multitouch_slots.hpp"
+#include "report_rate_analyzer.hpp"
 
 class EvdevInfo;
-
-class MultitouchState
-{
-public:
-  MultitouchState() :
-    x(0),
-    y(0),
-    tracking_id(0)
-  {}
-
-  MultitouchState(int x_, int y_, int tracking_id_) :
-    x(x_),
-    y(y_),
-    tracking_id(tracking_id_)
-  {}
-
-  int x;
-  int y;
-  int tracking_id;
-};
+class EvdevSnapshot;
+class LatencyTracker;
 
 class EvdevState : public QObject
 {
   Q_OBJECT
 
 private:
-  EvdevInfo m_info;
+  EvdevInfoPtr m_info;
+  DeviceClass::Type m_device_class;
+
+  // update_as<T>() of the device class, picked once on construction
+  void (EvdevState::*m_update)(const input_event& ev);
+
   std::vector<int32_t> m_abs_values;
   std::vector<int32_t> m_rel_values;
   std::vector<int32_t> m_key_values;
-  std::vector<MultitouchState> m_mt_states;
+  MultitouchSlots m_mt_slots;
+  // index of ABS_MT_SLOT in m_abs_values, EvdevInfo::npos when the
+  // device doesn't have MT slots
+  size_t m_mt_slot_idx;
+
+  // extremes seen since the last sig_change, so that values that
+  // only last for a fraction of a frame aren't lost, empty (min above
+  // max) until the axis gets an event
+  std::vector<int32_t> m_abs_min;
+  std::vector<int32_t> m_abs_max;
+  std::vector<int32_t> m_key_peak;
+
+  // indices into EvdevInfo::keys/abss/rels and the MT slots that
+  // received events since the last sig_change
+  DirtySet m_dirty_keys;
+  DirtySet m_dirty_abss;
+  DirtySet m_dirty_rels;
+
+  QTimer m_frame_timer;
+  bool m_frame_pending;
+
+  ReportRateAnalyzer m_report_rate;
+
+  // a SYN_DROPPED that reached the state, e.g. in a recording or
+  // from a source that can't resync, the events up to the next
+  // SYN_REPORT are incomplete and get ignored
+  bool m_dropping;
+  uint64_t m_syn_dropped;
+
+  LatencyTracker* m_latency;
+  // kernel timestamp of the first event of the current frame
+  uint64_t m_frame_usec;
 
 public:
-  EvdevState(const EvdevInfo& info);
+  /** With \a specialize false the device is always handled by the
+      generic update path, e.g. to compare it against the specialized
+      one */
+  EvdevState(EvdevInfoPtr info, bool specialize = true);
 
   void update(const input_event& ev);
 
+  /** Replace the state with the actual device state, e.g. right
+      after opening it, and emit sig_change for all of it */
+  void set_snapshot(const EvdevSnapshot& snapshot);
+
+  /** Limit sig_change to at most \a hz emissions per second, events
+      arriving in between are coalesced into the next frame, 0 emits
+      sig_change on every EV_SYN */
+  void set_frame_rate(int hz);
+
+  /** Measure the update and dispatch latency into \a latency, null
+      turns measuring off */
+  void set_latency_tracker(LatencyTracker* latency) { m_latency = latency; }
+
   int get_key_value(uint16_t code) const;
   int get_abs_value(uint16_t code) const;
   int get_rel_value(uint16_t code) const;
 
-  int get_mt_slot_count() const;
-  MultitouchState get_mt_state(int slot) const;
+  /** Lowest/highest value the axis reported since the last
+      sig_change, INT32_MAX/INT32_MIN when it reported none */
+  int get_abs_min(uint16_t code) const;
+  int get_abs_max(uint16_t code) const;
+
+  /** Highest value the key had since the last sig_change, lets a
+      press and release within the same frame be detected */
+  int get_key_peak(uint16_t code) const;
+
+  /** All ABS_MT_* axes of all slots, readable in place */
+  const MultitouchSlots& get_mt_slots() const { return m_mt_slots; }
+
+  /** The controls that changed since the last sig_change, valid
+      while sig_change is being emitted */
+  const DirtySet& get_dirty_keys() const { return m_dirty_keys; }
+  const DirtySet& get_dirty_abss() const { return m_dirty_abss; }
+  const DirtySet& get_dirty_rels() const { return m_dirty_rels; }
+  const DirtySet& get_dirty_mt_slots() const { return m_mt_slots.get_dirty_slots(); }
 
-  const EvdevInfo& get_info() const { return m_info; }
+  const EvdevInfo& get_info() const { return *m_info; }
+
+  /** The class whose update path handles the events */
+  DeviceClass::Type get_device_class() const { return m_device_class; }
+
+  /** The memory held by the state, without the shared EvdevInfo */
+  MemoryUsage get_memory_usage() const;
+
+  /** Report rate and jitter derived from the SYN_REPORT timestamps */
+  const ReportRateAnalyzer& get_report_rate() const { return m_report_rate; }
+
+  /** Number of SYN_DROPPED events passed to update() */
+  uint64_t get_syn_dropped() const { return m_syn_dropped; }
+
+private:
+  template<DeviceClass::Type T>
+  void update_as(const input_event& ev);
+
+  void update_syn(const input_event& ev);
+  void update_key(const input_event& ev);
+  void update_abs(const input_event& ev);
+  void clear_abs_extremes(size_t idx);
+  void update_rel(const input_event& ev);
+  void update_mt(const input_event& ev);
+
+  void emit_change();
+
+private slots:
+  void on_frame_timeout();
 
 signals:
   void sig_change(const EvdevState& state) const;
+
+private:
+  EvdevState(const EvdevState&) = delete;
+  EvdevState& operator=(const EvdevState&) = delete;
 };
 
 #endif
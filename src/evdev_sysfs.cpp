@@ -0,0 +1,219 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "evdev_sysfs.hpp"
+
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include "evdev_list.hpp"
+
+namespace {
+
+/** Reads the small attribute file \a name relative to \a dir_fd,
+    without the trailing newline */
+bool read_attr(int dir_fd, const char* name, std::string& value)
+{
+  int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  // attributes are at most a page
+  char buf[4096];
+  ssize_t len = ::read(fd, buf, sizeof(buf));
+  close(fd);
+  if (len < 0)
+  {
+    return false;
+  }
+
+  while(len > 0 && buf[len - 1] == '\n')
+  {
+    --len;
+  }
+  value.assign(buf, static_cast<size_t>(len));
+  return true;
+}
+
+uint16_t read_hex_attr(int dir_fd, const char* name)
+{
+  std::string value;
+  return read_attr(dir_fd, name, value) ? static_cast<uint16_t>(strtoul(value.c_str(), nullptr, 16)) : 0;
+}
+
+/** Parses a capability bitmap as the kernel prints it: hex words of
+    the kernel's long size, most significant first, separated by
+    spaces and with leading zero words left out */
+template<size_t N>
+void read_bitmap_attr(int dir_fd, const char* name, std::array<unsigned long, N>& bitmap)
+{
+  bitmap.fill(0);
+
+  std::string value;
+  if (!read_attr(dir_fd, name, value))
+  {
+    return;
+  }
+
+  std::vector<unsigned long> words;
+  const char* p = value.c_str();
+  while(*p != '\0')
+  {
+    char* end;
+    words.push_back(strtoul(p, &end, 16));
+    if (end == p)
+    {
+      break;
+    }
+    p = end;
+  }
+
+  for(size_t i = 0; i < std::min(N, words.size()); ++i)
+  {
+    bitmap[i] = words[words.size() - 1 - i];
+  }
+}
+
+} // namespace
+
+EvdevSysfs::EvdevSysfs(const std::string& sysfs_dir, const std::string& dev_dir) :
+  m_sysfs_dir(sysfs_dir),
+  m_dev_dir(dev_dir)
+{
+}
+
+std::vector<EvdevSysfs::Device>
+EvdevSysfs::scan() const
+{
+  DIR* dirp = opendir(m_sysfs_dir.c_str());
+  if (!dirp)
+  {
+    throw std::runtime_error(m_sysfs_dir + ": " + strerror(errno));
+  }
+
+  std::vector<Device> devices;
+  struct dirent* dentry;
+  while((dentry = readdir(dirp)) != nullptr)
+  {
+    if (EvdevList::is_event_device(dentry->d_name))
+    {
+      Device device;
+      if (read_node(dentry->d_name, device))
+      {
+        devices.push_back(std::move(device));
+      }
+    }
+  }
+  closedir(dirp);
+
+  std::sort(devices.begin(), devices.end(),
+            [](const Device& lhs, const Device& rhs) {
+              return EvdevList::less(lhs.filename, rhs.filename);
+            });
+  return devices;
+}
+
+bool
+EvdevSysfs::read(const std::string& filename, Device& device) const
+{
+  const std::string node = filename.substr(filename.rfind('/') + 1);
+  if (!EvdevList::is_event_device(node.c_str()))
+  {
+    return false;
+  }
+  else
+  {
+    return read_node(node, device);
+  }
+}
+
+bool
+EvdevSysfs::read_node(const std::string& node, Device& device) const
+{
+  const std::string path = m_sysfs_dir + "/" + node;
+  int node_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (node_fd < 0)
+  {
+    return false;
+  }
+
+  // "major:minor" of the node
+  std::string dev;
+  if (!read_attr(node_fd, "dev", dev))
+  {
+    close(node_fd);
+    return false;
+  }
+  const char* colon = strchr(dev.c_str(), ':');
+  device.rdev = colon ? makedev(static_cast<unsigned>(strtoul(dev.c_str(), nullptr, 10)),
+                                static_cast<unsigned>(strtoul(colon + 1, nullptr, 10))) : 0;
+
+  // the input device the event node belongs to
+  char link[PATH_MAX];
+  const ssize_t link_len = readlinkat(node_fd, "device", link, sizeof(link) - 1);
+  if (link_len > 0)
+  {
+    link[link_len] = '\0';
+    const char* slash = strrchr(link, '/');
+    device.input = slash ? slash + 1 : link;
+  }
+
+  int fd = openat(node_fd, "device", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  close(node_fd);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  std::string name;
+  std::string phys;
+  read_attr(fd, "name", name);
+  read_attr(fd, "phys", phys);
+
+  struct input_id id;
+  id.bustype = read_hex_attr(fd, "id/bustype");
+  id.vendor = read_hex_attr(fd, "id/vendor");
+  id.product = read_hex_attr(fd, "id/product");
+  id.version = read_hex_attr(fd, "id/version");
+
+  std::array<unsigned long, bits::nbits(EV_MAX)> bit;
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit;
+  std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit;
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit;
+  read_bitmap_attr(fd, "capabilities/ev", bit);
+  read_bitmap_attr(fd, "capabilities/abs", abs_bit);
+  read_bitmap_attr(fd, "capabilities/rel", rel_bit);
+  read_bitmap_attr(fd, "capabilities/key", key_bit);
+  close(fd);
+
+  device.filename = m_dev_dir + "/" + node;
+  device.info = EvdevInfo(0, name, phys, id, bit, abs_bit, rel_bit, key_bit,
+                          std::array<AbsInfo, ABS_CNT>());
+  return true;
+}
+
+/* EOF */
@@ -0,0 +1,83 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_EVDEV_SYSFS_HPP
+#define HEADER_EVDEV_SYSFS_HPP
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "evdev_info.hpp"
+
+/** Enumerates event devices through /sys/class/input, which has the
+    name, ids and capability bitmaps of every device, so listing them
+    needs neither opening the nodes nor read permission on them. */
+class EvdevSysfs
+{
+public:
+  class Device
+  {
+  public:
+    /** The node in the device directory, e.g. "/dev/input/event5" */
+    std::string filename;
+    dev_t rdev;
+
+    /** The input device the node belongs to, e.g. "input27", the
+        kernel numbers them anew for every device that shows up, so
+        a node reused by a different device gets a different one */
+    std::string input;
+
+    /** Everything but the AbsInfo ranges and the version, those are
+        only available through the node */
+    EvdevInfo info;
+
+    Device() :
+      filename(),
+      rdev(),
+      input(),
+      info()
+    {}
+  };
+
+private:
+  std::string m_sysfs_dir;
+  std::string m_dev_dir;
+
+public:
+  EvdevSysfs(const std::string& sysfs_dir = "/sys/class/input",
+             const std::string& dev_dir = "/dev/input");
+
+  /** All event devices sorted by their number, throws when the sysfs
+      directory isn't available */
+  std::vector<Device> scan() const;
+
+  /** Read the device behind the node \a filename, returns false when
+      sysfs doesn't know about it */
+  bool read(const std::string& filename, Device& device) const;
+
+private:
+  bool read_node(const std::string& node, Device& device) const;
+
+private:
+  EvdevSysfs(const EvdevSysfs&) = delete;
+  EvdevSysfs& operator=(const EvdevSysfs&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -14,23 +14,47 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <climits>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 
+#include "device_class.hpp"
 #include "evdev_device.hpp"
 #include "evdev_enum.hpp"
+#include "evdev_recorder.hpp"
+#include "evdev_sysfs.hpp"
+#include "event_filter.hpp"
+#include "event_time.hpp"
+#include "event_writer.hpp"
+#include "latency_tracker.hpp"
+#include "report_rate_analyzer.hpp"
+#include "synthetic_source.hpp"
+#include "util.hpp"
+
+namespace {
 
 void print_evdev_info(const EvdevInfo& info)
 {
   std::cout << "name: '" << info.name << "'" << std::endl;
+  std::cout << "class: " << DeviceClass::name(DeviceClass::classify(info)) << std::endl;
 
   if (!info.abss.empty())
   {
     std::cout << "abs: " << info.abss.size() << "\n";
     for(size_t i = 0; i < info.abss.size(); ++i)
     {
-      auto absinfo = info.get_absinfo(info.abss[i]);
+      const auto& absinfo = info.get_absinfo(info.abss[i]);
       std::cout << "  " << evdev_abs_name(info.abss[i])
                 << " value:" << absinfo.value
                 << " min:" << absinfo.minimum
@@ -63,85 +87,478 @@ void print_evdev_info(const EvdevInfo& info)
   }
 }
 
-void print_events(EvdevDevice& device)
+class Options
+{
+public:
+  std::string device;
+  std::string synthetic;
+  std::string format;
+  std::string output;
+  std::string filter;
+  uint64_t count;
+  double duration;
+  bool latency;
+  bool rate;
+  bool kernel_mask;
+  bool list;
+
+  Options() :
+    device(),
+    synthetic(),
+    format("text"),
+    output(),
+    filter(),
+    count(0),
+    duration(0.0),
+    latency(false),
+    rate(false),
+    kernel_mask(false),
+    list(false)
+  {}
+};
+
+void print_help(const char* program)
+{
+  std::cout << "Usage: " << program << " [OPTION]... DEVICE\n"
+            << "       " << program << " [OPTION]... --synthetic PROFILE[:HZ]\n"
+            << "       " << program << " --list\n"
+            << "Prints the capabilities and events of an event device\n"
+            << "\n"
+            << "   --list            List the event devices without opening them\n"
+            << "   --format FORMAT   text (default), csv, jsonl or binary (a --record file)\n"
+            << "   --output FILE     Write the events to FILE instead of stdout\n"
+            << "   --filter EXPR     Only write events matching EXPR, e.g.\n"
+            << "                     'type==EV_ABS && code in {ABS_X,ABS_Y} && |value|>100'\n"
+            << "   --kernel-mask     Have the kernel drop what the --filter rejects, the\n"
+            << "                     statistics then only cover the remaining events\n"
+            << "   --count N         Stop after N events\n"
+            << "   --duration SEC    Stop after SEC seconds\n"
+            << "   --latency         Print the read latency p50/p99/max once per second\n"
+            << "   --rate            Print the report rate, interval and jitter once per second\n"
+            << "   --synthetic PROFILE[:HZ]\n"
+            << "                     Read a generated gamepad, mouse or keyboard instead of\n"
+            << "                     a device, to measure the throughput\n"
+            << "\n"
+            << "Statistics go to stderr, so stdout only carries the events.\n";
+}
+
+/** The whole of \a str as a decimal number, false on anything else,
+    including a sign or a value out of range */
+bool parse_uint64(const std::string& str, uint64_t& value)
+{
+  if (str.empty() || !isdigit(static_cast<unsigned char>(str[0])))
+  {
+    return false;
+  }
+
+  char* end;
+  errno = 0;
+  const unsigned long long result = strtoull(str.c_str(), &end, 10);
+  if (errno != 0 || *end != '\0')
+  {
+    return false;
+  }
+  value = result;
+  return true;
+}
+
+bool parse_int(const std::string& str, int& value)
 {
-  std::cout << "reading events..." << std::endl;
-  std::array<struct input_event, 1> ev;
-  while(true)
+  uint64_t result;
+  if (!parse_uint64(str, result) || result > static_cast<uint64_t>(INT_MAX))
   {
-    ssize_t num_events = device.read_events(ev.data(), ev.size());
-    if (num_events < 0)
+    return false;
+  }
+  value = static_cast<int>(result);
+  return true;
+}
+
+/** The whole of \a str as a finite, non-negative number */
+bool parse_seconds(const std::string& str, double& value)
+{
+  if (str.empty())
+  {
+    return false;
+  }
+
+  char* end;
+  errno = 0;
+  const double result = strtod(str.c_str(), &end);
+  if (errno != 0 || *end != '\0' || !std::isfinite(result) || result < 0.0)
+  {
+    return false;
+  }
+  value = result;
+  return true;
+}
+
+int list_devices()
+{
+  for(const auto& dev : EvdevSysfs().scan())
+  {
+    std::cout << dev.filename << ": " << dev.info.name
+              << std::hex << std::setfill('0')
+              << " (bus " << std::setw(4) << dev.info.id.bustype
+              << " id " << std::setw(4) << dev.info.id.vendor
+              << ":" << std::setw(4) << dev.info.id.product << ")"
+              << std::dec << std::setfill(' ') << "\n";
+  }
+  return 0;
+}
+
+double cpu_seconds()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+    static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void print_stats(LatencyTracker* latency, ReportRateAnalyzer* report_rate)
+{
+  if (latency)
+  {
+    std::cerr << "latency: " << latency->str() << std::endl;
+  }
+  if (report_rate)
+  {
+    std::cerr << "report rate: " << report_rate->str() << std::endl;
+  }
+}
+
+/** Reads events until interrupted, the device is gone or the count
+    or duration of \a opts is reached, waiting in epoll_wait() between
+    reads. Only the events passing \a filter get written. */
+int capture(EventSource& source, const EvdevInfo& info, const EventFilter& filter,
+            const Options& opts)
+{
+  const bool binary = opts.format == "binary";
+
+  int out_fd = STDOUT_FILENO;
+  if (!opts.output.empty() && !binary)
+  {
+    out_fd = ::open(opts.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out_fd < 0)
+    {
+      throw std::runtime_error(opts.output + ": " + strerror(errno));
+    }
+  }
+
+  std::unique_ptr<EventWriter> writer;
+  std::unique_ptr<EvdevRecorder> recorder;
+  if (binary)
+  {
+    recorder = util::make_unique<EvdevRecorder>(opts.output.empty() ? "/dev/stdout" : opts.output, info);
+  }
+  else
+  {
+    writer = util::make_unique<EventWriter>(out_fd, EventWriter::parse_format(opts.format));
+    writer->write_header();
+  }
+
+  LatencyTracker latency;
+  ReportRateAnalyzer report_rate;
+  LatencyTracker* const latency_ptr = opts.latency ? &latency : nullptr;
+  ReportRateAnalyzer* const report_rate_ptr = opts.rate ? &report_rate : nullptr;
+
+  // Ctrl-C ends the capture cleanly, so the buffers get flushed and
+  // the summary printed
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, nullptr);
+  int signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event source_ev;
+  source_ev.events = EPOLLIN;
+  source_ev.data.fd = source.get_fd();
+  struct epoll_event signal_ev;
+  signal_ev.events = EPOLLIN;
+  signal_ev.data.fd = signal_fd;
+  if (signal_fd < 0 || epoll_fd < 0 ||
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, source.get_fd(), &source_ev) < 0 ||
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &signal_ev) < 0)
+  {
+    throw std::runtime_error(std::string("epoll: ") + strerror(errno));
+  }
+
+  const uint64_t start = LatencyTracker::now_usec();
+  const double start_cpu = cpu_seconds();
+  const uint64_t deadline = opts.duration > 0.0 ? start + static_cast<uint64_t>(opts.duration * 1e6) : 0;
+  uint64_t last_stats = start;
+  uint64_t last_flush = start;
+  uint64_t total = 0;
+  uint64_t passed = 0;
+  std::vector<struct input_event> ev(1024);
+  int ret = 0;
+
+  bool quit = false;
+  while(!quit)
+  {
+    // wake up in time to flush pending output, print the statistics
+    // or end the capture
+    uint64_t now = LatencyTracker::now_usec();
+    uint64_t wakeup = UINT64_MAX;
+    if (writer && writer->has_pending())
+    {
+      wakeup = std::min(wakeup, last_flush + 100000);
+    }
+    if (latency_ptr || report_rate_ptr)
+    {
+      wakeup = std::min(wakeup, last_stats + 1000000);
+    }
+    if (deadline)
+    {
+      wakeup = std::min(wakeup, deadline);
+    }
+    const int timeout = wakeup == UINT64_MAX ? -1 : static_cast<int>(wakeup > now ? (wakeup - now + 999) / 1000 : 0);
+
+    std::array<struct epoll_event, 2> events;
+    int num_ready = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), timeout);
+    if (num_ready < 0 && errno != EINTR)
     {
-      std::cout << "error: " << num_events << ": " << strerror(errno) << std::endl;
+      std::cerr << "error: epoll_wait: " << strerror(errno) << std::endl;
+      ret = 1;
       break;
     }
-    else
+
+    for(int i = 0; i < num_ready; ++i)
     {
-      for(size_t i = 0; i < static_cast<size_t>(num_events); ++i)
+      if (events[static_cast<size_t>(i)].data.fd == signal_fd)
       {
-        if (ev[i].type == EV_SYN)
+        quit = true;
+        continue;
+      }
+
+      ssize_t num_events;
+      while((num_events = source.read_events(ev.data(), ev.size())) > 0)
+      {
+        size_t n = static_cast<size_t>(num_events);
+        if (opts.count && total + n >= opts.count)
         {
-          std::cout << "--------- sync ---------" << std::endl;
+          n = static_cast<size_t>(opts.count - total);
+          quit = true;
         }
-        else
+        total += n;
+
+        if (latency_ptr || report_rate_ptr)
         {
-          switch(ev[i].type)
+          const uint64_t read_usec = LatencyTracker::now_usec();
+          for(size_t j = 0; j < n; ++j)
           {
-            case EV_ABS:
-              std::cout << std::setw(8) << ev[i].type << " "
-                        << std::setw(8) << evdev_abs_name(ev[i].code) << " "
-                        << std::setw(8) << ev[i].value << std::endl;
-              break;
-
-            case EV_REL:
-              std::cout << std::setw(8) << ev[i].type << " "
-                        << std::setw(8) << evdev_rel_name(ev[i].code) << " "
-                        << std::setw(8) << ev[i].value << std::endl;
-              break;
-
-            case EV_KEY:
-              std::cout << std::setw(8) << ev[i].type << " "
-                        << std::setw(8) << evdev_key_name(ev[i].code) << " "
-                        << std::setw(8) << ev[i].value << std::endl;
-              break;
-
-            default:
-              std::cout << std::setw(8) << ev[i].type << " "
-                        << std::setw(8) << ev[i].code << " "
-                        << std::setw(8) << ev[i].value << std::endl;
-              break;
+            if (latency_ptr)
+            {
+              latency_ptr->record(LatencyTracker::kRead, get_event_usec(ev[j]), read_usec);
+            }
+            if (report_rate_ptr && ev[j].type == EV_SYN && ev[j].code == SYN_REPORT)
+            {
+              report_rate_ptr->add_report(get_event_usec(ev[j]));
+            }
           }
         }
+
+        // filtered after the statistics, which need every event, a
+        // recording keeps EV_SYN so it can be replayed frame by frame
+        const size_t num_passed = filter.filter(ev.data(), n, binary);
+        passed += num_passed;
+
+        if (writer)
+        {
+          writer->write(ev.data(), num_passed);
+        }
+        else
+        {
+          recorder->record(ev.data(), num_passed);
+        }
+
+        if (quit || n < ev.size())
+        {
+          break;
+        }
       }
+
+      if (num_events < 0 || (events[static_cast<size_t>(i)].events & (EPOLLERR | EPOLLHUP)))
+      {
+        std::cerr << "error: " << source.get_filename() << ": reading events failed" << std::endl;
+        ret = 1;
+        quit = true;
+      }
+    }
+
+    now = LatencyTracker::now_usec();
+    if (writer && writer->has_pending() && now - last_flush >= 100000)
+    {
+      writer->flush();
+      last_flush = now;
+    }
+    if ((latency_ptr || report_rate_ptr) && now - last_stats >= 1000000)
+    {
+      print_stats(latency_ptr, report_rate_ptr);
+      last_stats = now;
+    }
+    if (deadline && now >= deadline)
+    {
+      quit = true;
     }
   }
+
+  if (writer)
+  {
+    writer->flush();
+  }
+  const uint64_t bytes = writer ? writer->get_bytes() : recorder->get_bytes();
+  recorder.reset();
+
+  const double secs = static_cast<double>(LatencyTracker::now_usec() - start) / 1e6;
+  const double cpu = cpu_seconds() - start_cpu;
+  print_stats(latency_ptr, report_rate_ptr);
+  std::cerr << std::fixed << std::setprecision(2)
+            << total << " events";
+  if (!filter.empty())
+  {
+    std::cerr << " (" << passed << " passed the filter)";
+  }
+  std::cerr << ", " << bytes << " bytes in " << secs << " s, "
+            << static_cast<double>(total) / secs << " events/s, "
+            << "cpu " << cpu << " s (" << 100.0 * cpu / secs << "%)" << std::endl;
+
+  close(epoll_fd);
+  close(signal_fd);
+  if (out_fd != STDOUT_FILENO)
+  {
+    close(out_fd);
+  }
+  return ret;
 }
 
+} // namespace
+
 int main(int argc, char** argv)
 {
-  if (argc != 2)
+  Options opts;
+  for(int i = 1; i < argc; ++i)
   {
-    std::cout << "Usage: " << argv[0] << " DEVICE\n";
-    return 1;
+    const bool has_arg = i + 1 < argc;
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
+    {
+      print_help(argv[0]);
+      return 0;
+    }
+    else if (strcmp(argv[i], "--latency") == 0)
+    {
+      opts.latency = true;
+    }
+    else if (strcmp(argv[i], "--list") == 0)
+    {
+      opts.list = true;
+    }
+    else if (strcmp(argv[i], "--kernel-mask") == 0)
+    {
+      opts.kernel_mask = true;
+    }
+    else if (strcmp(argv[i], "--rate") == 0)
+    {
+      opts.rate = true;
+    }
+    else if (strcmp(argv[i], "--format") == 0 && has_arg)
+    {
+      opts.format = argv[++i];
+    }
+    else if (strcmp(argv[i], "--output") == 0 && has_arg)
+    {
+      opts.output = argv[++i];
+    }
+    else if (strcmp(argv[i], "--filter") == 0 && has_arg)
+    {
+      opts.filter = argv[++i];
+    }
+    else if (strcmp(argv[i], "--count") == 0 && has_arg && parse_uint64(argv[i + 1], opts.count))
+    {
+      ++i;
+    }
+    else if (strcmp(argv[i], "--duration") == 0 && has_arg && parse_seconds(argv[i + 1], opts.duration))
+    {
+      ++i;
+    }
+    else if (strcmp(argv[i], "--synthetic") == 0 && has_arg)
+    {
+      opts.synthetic = argv[++i];
+    }
+    else if (argv[i][0] != '-' && opts.device.empty())
+    {
+      opts.device = argv[i];
+    }
+    else
+    {
+      print_help(argv[0]);
+      return 1;
+    }
   }
-  else
+
+  if (opts.list)
   {
     try
     {
-      auto device = EvdevDevice::open(argv[1]);
-      auto info = device->read_evdev_info();
-
-      print_evdev_info(info);
-      print_events(*device);
-
-      return 0;
+      return list_devices();
     }
-    catch(std::exception const& err)
+    catch(const std::exception& err)
     {
       std::cerr << "error: " << err.what() << std::endl;
       return 1;
     }
   }
+
+  if (opts.device.empty() == opts.synthetic.empty())
+  {
+    print_help(argv[0]);
+    return 1;
+  }
+
+  int synthetic_rate = 1000;
+  const std::string::size_type colon = opts.synthetic.find(':');
+  if (colon != std::string::npos && !parse_int(opts.synthetic.substr(colon + 1), synthetic_rate))
+  {
+    print_help(argv[0]);
+    return 1;
+  }
+
+  try
+  {
+    const EventFilter filter(opts.filter);
+
+    std::unique_ptr<EventSource> source;
+    if (!opts.synthetic.empty())
+    {
+      source = util::make_unique<SyntheticSource>(SyntheticSource::parse_profile(opts.synthetic.substr(0, colon)),
+                                                  synthetic_rate);
+    }
+    else
+    {
+      source = EvdevDevice::open(opts.device);
+    }
+
+    if (opts.kernel_mask && !filter.empty() && !source->set_event_mask(filter))
+    {
+      std::cerr << "warning: " << source->get_filename()
+                << ": kernel side filtering not supported" << std::endl;
+    }
+
+    auto info = source->read_evdev_info();
+    if (opts.format == "text" && opts.output.empty())
+    {
+      print_evdev_info(info);
+      std::cout << "reading events..." << std::endl;
+    }
+
+    return capture(*source, info, filter, opts);
+  }
+  catch(std::exception const& err)
+  {
+    std::cerr << "error: " << err.what() << std::endl;
+    return 1;
+  }
 }
 
 /* EOF */
@@ -0,0 +1,124 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "evdev_watcher.hpp"
+
+#include <errno.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "evdev_list.hpp"
+#include "util.hpp"
+
+EvdevWatcher::EvdevWatcher(const std::string& directory, QObject* parent_) :
+  QObject(parent_),
+  m_directory(directory),
+  m_fd(-1),
+  m_notifier()
+{
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_fd < 0)
+  {
+    throw std::runtime_error(std::string("inotify_init1: ") + strerror(errno));
+  }
+
+  if (inotify_add_watch(m_fd, m_directory.c_str(),
+                        IN_CREATE | IN_DELETE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO) < 0)
+  {
+    int err = errno;
+    close(m_fd);
+    throw std::runtime_error(m_directory + ": " + strerror(err));
+  }
+
+  m_notifier = util::make_unique<QSocketNotifier>(m_fd, QSocketNotifier::Read);
+  QObject::connect(m_notifier.get(), SIGNAL(activated(int)),
+                   this, SLOT(on_notification(int)));
+}
+
+EvdevWatcher::~EvdevWatcher()
+{
+  m_notifier.reset();
+  close(m_fd);
+}
+
+void
+EvdevWatcher::on_notification(int fd)
+{
+  // large enough for a good number of events, the kernel never splits
+  // a single event across reads
+  alignas(struct inotify_event) char buf[4096];
+
+  while(true)
+  {
+    ssize_t len = ::read(m_fd, buf, sizeof(buf));
+    if (len < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else if (len < 0 && errno != EAGAIN)
+    {
+      m_notifier->setEnabled(false);
+      sig_failed();
+      return;
+    }
+    else if (len <= 0)
+    {
+      return;
+    }
+
+    for(char* ptr = buf; ptr < buf + len; )
+    {
+      const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(ptr);
+      ptr += sizeof(struct inotify_event) + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW)
+      {
+        // the queue was full, anything could have happened since
+        sig_overflow();
+        continue;
+      }
+      else if (ev->mask & IN_IGNORED)
+      {
+        m_notifier->setEnabled(false);
+        sig_failed();
+        return;
+      }
+
+      if (ev->len == 0 || !EvdevList::is_event_device(ev->name))
+      {
+        continue;
+      }
+
+      const QString device = QString::fromStdString(m_directory + "/" + ev->name);
+      if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+      {
+        sig_device_added(device);
+      }
+      else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+      {
+        sig_device_removed(device);
+      }
+      else if (ev->mask & IN_ATTRIB)
+      {
+        sig_device_changed(device);
+      }
+    }
+  }
+}
+
+/* EOF */
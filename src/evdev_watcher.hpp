@@ -0,0 +1,70 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_EVDEV_WATCHER_HPP
+#define HEADER_EVDEV_WATCHER_HPP
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QString>
+
+#include <memory>
+#include <string>
+
+/** Watches a directory of event devices with inotify and reports
+    added and removed devices as they happen */
+class EvdevWatcher : public QObject
+{
+  Q_OBJECT
+
+private:
+  std::string m_directory;
+  int m_fd;
+  std::unique_ptr<QSocketNotifier> m_notifier;
+
+public:
+  /** Throws std::runtime_error when inotify isn't available, the
+      caller is expected to fall back to polling EvdevList::scan() */
+  EvdevWatcher(const std::string& directory, QObject* parent = nullptr);
+  virtual ~EvdevWatcher();
+
+private slots:
+  void on_notification(int fd);
+
+signals:
+  void sig_device_added(const QString& device);
+  void sig_device_removed(const QString& device);
+
+  /** The attributes of the device changed, e.g. udev adjusted the
+      permissions of a freshly created node */
+  void sig_device_changed(const QString& device);
+
+  /** The kernel dropped notifications, the directory has to be
+      scanned in full */
+  void sig_overflow();
+
+  /** The watch is gone, e.g. the directory was removed, or inotify
+      failed, nothing more will be reported */
+  void sig_failed();
+
+private:
+  EvdevWatcher(const EvdevWatcher&) = delete;
+  EvdevWatcher& operator=(const EvdevWatcher&) = delete;
+};
+
+#endif
+
+/* EOF */
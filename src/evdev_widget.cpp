@@ -16,6 +16,7 @@
 
 #include "evdev_widget.hpp"
 
+#include "latency_tracker.hpp"
 #include "multitouch_widget.hpp"
 #include "util.hpp"
 
@@ -35,7 +36,18 @@ EvdevWidget::EvdevWidget(const EvdevState& state, const EvdevInfo& info, QWidget
   m_driver_version_v_label(),
   m_device_id_v_label(),
   m_device_name_v_label(),
-  m_device_phys_v_label()
+  m_device_phys_v_label(),
+  m_axis_widgets(),
+  m_rel_widgets(),
+  m_button_widgets(),
+  m_multitouch_widget(),
+  m_state(state),
+  m_report_rate_label(),
+  m_channel(),
+  m_dropped_label(),
+  m_latency(),
+  m_latency_label(),
+  m_stats_timer()
 {
   m_info_layout.setColumnStretch(0, 0);
   m_info_layout.setColumnStretch(1, 1);
@@ -57,12 +69,10 @@ EvdevWidget::EvdevWidget(const EvdevState& state, const EvdevInfo& info, QWidget
 
   if (info.has_abs(ABS_MT_SLOT))
   {
-    auto multitouch_widget = util::make_unique<MultitouchWidget>();
+    auto multitouch_widget = util::make_unique<MultitouchWidget>(state);
     multitouch_widget->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
 
-    QObject::connect(&state, SIGNAL(sig_change(EvdevState const &)),
-                     multitouch_widget.get(), SLOT(on_change(EvdevState const &)));
-
+    m_multitouch_widget = multitouch_widget.get();
     m_vbox_layout.addWidget(multitouch_widget.release());
   }
 
@@ -90,15 +100,17 @@ EvdevWidget::EvdevWidget(const EvdevState& state, const EvdevInfo& info, QWidget
   // axis widgets
   for(size_t i = 0; i < info.abss.size(); ++i)
   {
-    AbsInfo absinfo = info.get_absinfo(info.abss[i]);
+    const AbsInfo& absinfo = info.get_absinfo(info.abss[i]);
     auto label = util::make_unique<QLabel>(QString::fromStdString(evdev_abs_name(info.abss[i]) + ":"));
     auto axis_widget = util::make_unique<AxisWidget>(info.abss[i], absinfo.minimum, absinfo.maximum);
 
     label->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Minimum);
     axis_widget->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
+    // only show the value the state was seeded with, a resting
+    // position doesn't count as a tested extreme
+    axis_widget->set_axis_pos(state.get_abs_value(info.abss[i]));
 
-    QObject::connect(&state, SIGNAL(sig_change(EvdevState const&)),
-                     axis_widget.get(), SLOT(on_change(EvdevState const&)));
+    m_axis_widgets.push_back(axis_widget.get());
 
     m_axis_layout.addWidget(label.release(), static_cast<int>(i), 0, Qt::AlignRight);
     m_axis_layout.addWidget(axis_widget.release(), static_cast<int>(i), 1);
@@ -113,8 +125,7 @@ EvdevWidget::EvdevWidget(const EvdevState& state, const EvdevInfo& info, QWidget
     label->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Minimum);
     rel_widget->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
 
-    QObject::connect(&state, SIGNAL(sig_change(EvdevState const&)),
-                     rel_widget.get(), SLOT(on_change(EvdevState const&)));
+    m_rel_widgets.push_back(rel_widget.get());
 
     m_rel_layout.addWidget(label.release(), static_cast<int>(i), 0, Qt::AlignRight);
     m_rel_layout.addWidget(rel_widget.release(), static_cast<int>(i), 1);
@@ -127,8 +138,7 @@ EvdevWidget::EvdevWidget(const EvdevState& state, const EvdevInfo& info, QWidget
   {
     auto button_widget = util::make_unique<ButtonWidget>(info.keys[i]);
 
-    QObject::connect(&state, SIGNAL(sig_change(EvdevState const&)),
-                     button_widget.get(), SLOT(on_change(EvdevState const&)));
+    m_button_widgets.push_back(button_widget.get());
 
     button_widget->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
     m_button_layout.addWidget(button_widget.release(), row, col);
@@ -140,12 +150,114 @@ EvdevWidget::EvdevWidget(const EvdevState& state, const EvdevInfo& info, QWidget
       row += 1;
     }
   }
+
+  m_vbox_layout.addWidget(&m_report_rate_label);
+  QObject::connect(&m_stats_timer, SIGNAL(timeout()),
+                   this, SLOT(on_stats_timeout()));
+  m_stats_timer.start(1000);
+  on_stats_timeout();
+
+  // a single connection for the whole device, on_change() only
+  // dispatches to the widgets that are affected
+  QObject::connect(&state, SIGNAL(sig_change(EvdevState const&)),
+                   this, SLOT(on_change(EvdevState const&)));
 }
 
 EvdevWidget::~EvdevWidget()
 {
 }
 
+void
+EvdevWidget::on_change(const EvdevState& state)
+{
+  for(auto idx : state.get_dirty_abss().items())
+  {
+    m_axis_widgets[idx]->on_change(state);
+  }
+
+  for(auto idx : state.get_dirty_rels().items())
+  {
+    m_rel_widgets[idx]->on_change(state);
+  }
+
+  for(auto idx : state.get_dirty_keys().items())
+  {
+    m_button_widgets[idx]->on_change(state);
+  }
+
+  if (m_multitouch_widget && !state.get_dirty_mt_slots().empty())
+  {
+    m_multitouch_widget->on_change(state);
+  }
+}
+
+void
+EvdevWidget::set_channel(const EvdevReader::Channel* channel)
+{
+  m_channel = channel;
+  m_vbox_layout.addWidget(&m_dropped_label);
+  on_stats_timeout();
+}
+
+void
+EvdevWidget::set_disconnected()
+{
+  m_channel = nullptr;
+  m_dropped_label.setText("Disconnected: reading events failed");
+  setEnabled(false);
+}
+
+void
+EvdevWidget::set_latency_tracker(LatencyTracker* latency)
+{
+  m_latency = latency;
+
+  // a child repaint doesn't go through the EvdevWidget, so watch
+  // the paint events of every child
+  for(QWidget* child : findChildren<QWidget*>())
+  {
+    child->installEventFilter(this);
+  }
+
+  m_vbox_layout.addWidget(&m_latency_label);
+  on_stats_timeout();
+}
+
+bool
+EvdevWidget::eventFilter(QObject* obj, QEvent* ev)
+{
+  if (m_latency && ev->type() == QEvent::Paint)
+  {
+    m_latency->painted(LatencyTracker::now_usec());
+  }
+  return QWidget::eventFilter(obj, ev);
+}
+
+void
+EvdevWidget::on_stats_timeout()
+{
+  const std::string rate = m_state.get_report_rate().str();
+  m_report_rate_label.setText(QString::fromStdString("Report rate: " + (rate.empty() ? "no reports yet" : rate)));
+
+  if (m_channel)
+  {
+    // the totals only ever grow, a SYN_DROPPED means the reader
+    // thread didn't keep up with the kernel, a ring overflow means
+    // the GUI thread didn't keep up with the reader thread
+    m_dropped_label.setText(QString("Dropped: %1 SYN_DROPPED, %2 events discarded, %3 resyncs, %4 ring overflows")
+                            .arg(static_cast<unsigned long long>(m_channel->get_syn_dropped()))
+                            .arg(static_cast<unsigned long long>(m_channel->get_discarded()))
+                            .arg(static_cast<unsigned long long>(m_channel->get_resyncs()))
+                            .arg(static_cast<unsigned long long>(m_channel->get_overflows())));
+  }
+
+  if (m_latency)
+  {
+    const std::string str = m_latency->str();
+    m_latency_label.setText(QString::fromStdString("Latency: " + (str.empty() ? "no events yet" : str)));
+  }
+}
+
 bool EvdevWidget::all_tested()
 {
   for(int idx = 0; idx < m_axis_layout.count(); idx++)
@@ -25,6 +25,8 @@
 #include <QSocketNotifier>
 #include <QVBoxLayout>
 #include <QComboBox>
+#include <QEvent>
+#include <QTimer>
 
 #include <fcntl.h>
 #include <iostream>
@@ -39,8 +41,12 @@
 #include "evdev_device.hpp"
 #include "evdev_enum.hpp"
 #include "evdev_list.hpp"
+#include "evdev_reader.hpp"
 #include "evdev_state.hpp"
 
+class LatencyTracker;
+class MultitouchWidget;
+
 class EvdevWidget : public QWidget
 {
   Q_OBJECT
@@ -63,12 +69,48 @@ private:
   QLabel m_device_name_v_label;
   QLabel m_device_phys_v_label;
 
+  // widgets indexed like EvdevInfo::abss/rels/keys
+  std::vector<AxisWidget*> m_axis_widgets;
+  std::vector<RelWidget*> m_rel_widgets;
+  std::vector<ButtonWidget*> m_button_widgets;
+  MultitouchWidget* m_multitouch_widget;
+
+  const EvdevState& m_state;
+
+  // report rate and latency statistics, refreshed once per second
+  QLabel m_report_rate_label;
+  const EvdevReader::Channel* m_channel;
+  QLabel m_dropped_label;
+  LatencyTracker* m_latency;
+  QLabel m_latency_label;
+  QTimer m_stats_timer;
+
 public:
   EvdevWidget(const EvdevState& state, const EvdevInfo& info, QWidget* parent=0);
   virtual ~EvdevWidget();
 
   bool all_tested();
 
+  /** Show the drop counters of the Channel the events come from */
+  void set_channel(const EvdevReader::Channel* channel);
+
+  /** The device can't be read anymore, forget the Channel and grey
+      out the controls */
+  void set_disconnected();
+
+  /** Record paint latency into \a latency and show its statistics */
+  void set_latency_tracker(LatencyTracker* latency);
+
+protected:
+  bool eventFilter(QObject* obj, QEvent* ev) override;
+
+public slots:
+  /** Forwards the change to the widgets whose controls changed */
+  void on_change(const EvdevState& state);
+
+private slots:
+  void on_stats_timeout();
+
 private:
   EvdevWidget(const EvdevWidget&) = delete;
   EvdevWidget& operator=(const EvdevWidget&) = delete;
@@ -0,0 +1,558 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "event_filter.hpp"
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdexcept>
+#include <stdlib.h>
+
+#include "evdev_enum.hpp"
+
+namespace {
+
+// deepest the evaluation stack may get, a filter is a handful of
+// terms, nothing written by hand gets anywhere close
+const size_t kMaxDepth = 64;
+
+// the result of an Op when only the type and code are known
+enum Tristate { kFalse, kTrue, kUnknown };
+
+Tristate tri_and(Tristate lhs, Tristate rhs)
+{
+  if (lhs == kFalse || rhs == kFalse)
+  {
+    return kFalse;
+  }
+  else if (lhs == kTrue && rhs == kTrue)
+  {
+    return kTrue;
+  }
+  else
+  {
+    return kUnknown;
+  }
+}
+
+Tristate tri_or(Tristate lhs, Tristate rhs)
+{
+  if (lhs == kTrue || rhs == kTrue)
+  {
+    return kTrue;
+  }
+  else if (lhs == kFalse && rhs == kFalse)
+  {
+    return kFalse;
+  }
+  else
+  {
+    return kUnknown;
+  }
+}
+
+Tristate tri_not(Tristate value)
+{
+  return value == kUnknown ? kUnknown : value == kTrue ? kFalse : kTrue;
+}
+
+bool lookup_type(const std::string& name, int64_t& type)
+{
+  for(uint16_t i = 0; i < EV_CNT; ++i)
+  {
+    const char* type_name = evdev_type_cname(i);
+    if (type_name && name == type_name)
+    {
+      type = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+/** Recursive descent parser that emits the postfix program */
+class EventFilter::Parser
+{
+private:
+  EventFilter& m_filter;
+  const std::string& m_expr;
+  size_t m_pos;
+
+  // the current token, empty at the end of the expression
+  std::string m_token;
+  size_t m_token_pos;
+
+public:
+  Parser(EventFilter& filter, const std::string& expr) :
+    m_filter(filter),
+    m_expr(expr),
+    m_pos(0),
+    m_token(),
+    m_token_pos(0)
+  {
+    next();
+  }
+
+  void parse()
+  {
+    parse_or();
+    if (!m_token.empty())
+    {
+      error("unexpected '" + m_token + "'");
+    }
+  }
+
+private:
+  void next()
+  {
+    while(m_pos < m_expr.size() && isspace(static_cast<unsigned char>(m_expr[m_pos])))
+    {
+      ++m_pos;
+    }
+
+    m_token_pos = m_pos;
+    if (m_pos == m_expr.size())
+    {
+      m_token.clear();
+      return;
+    }
+
+    const char c = m_expr[m_pos];
+    size_t end = m_pos + 1;
+    if (isalnum(static_cast<unsigned char>(c)) || c == '_' ||
+        (c == '-' && end < m_expr.size() && isdigit(static_cast<unsigned char>(m_expr[end]))))
+    {
+      while(end < m_expr.size() &&
+            (isalnum(static_cast<unsigned char>(m_expr[end])) || m_expr[end] == '_'))
+      {
+        ++end;
+      }
+    }
+    else if (m_expr.compare(m_pos, 2, "&&") == 0 ||
+             m_expr.compare(m_pos, 2, "||") == 0 ||
+             m_expr.compare(m_pos, 2, "==") == 0 ||
+             m_expr.compare(m_pos, 2, "!=") == 0 ||
+             m_expr.compare(m_pos, 2, "<=") == 0 ||
+             m_expr.compare(m_pos, 2, ">=") == 0)
+    {
+      end = m_pos + 2;
+    }
+
+    m_token = m_expr.substr(m_pos, end - m_pos);
+    m_pos = end;
+  }
+
+  void expect(const char* token)
+  {
+    if (m_token != token)
+    {
+      error(std::string("expected '") + token + "'");
+    }
+    next();
+  }
+
+  void error(const std::string& msg) const
+  {
+    throw std::runtime_error("filter: " + msg + " at column " +
+                             std::to_string(m_token_pos + 1) + " of '" + m_expr + "'");
+  }
+
+  void emit(Op::Kind kind, Field field = kType, Cmp cmp = kEq, int64_t arg = 0)
+  {
+    Op op;
+    op.kind = kind;
+    op.field = field;
+    op.cmp = cmp;
+    op.arg = arg;
+    m_filter.m_program.push_back(op);
+  }
+
+  void parse_or()
+  {
+    parse_and();
+    while(m_token == "||")
+    {
+      next();
+      parse_and();
+      emit(Op::kOr);
+    }
+  }
+
+  void parse_and()
+  {
+    parse_unary();
+    while(m_token == "&&")
+    {
+      next();
+      parse_unary();
+      emit(Op::kAnd);
+    }
+  }
+
+  void parse_unary()
+  {
+    if (m_token == "!")
+    {
+      next();
+      parse_unary();
+      emit(Op::kNot);
+    }
+    else if (m_token == "(")
+    {
+      next();
+      parse_or();
+      expect(")");
+    }
+    else if (m_token == "|")
+    {
+      next();
+      expect("value");
+      expect("|");
+      parse_comparison(kAbsValue);
+    }
+    else if (m_token == "type")
+    {
+      next();
+      parse_comparison(kType);
+    }
+    else if (m_token == "code")
+    {
+      next();
+      parse_comparison(kCode);
+    }
+    else if (m_token == "value")
+    {
+      next();
+      parse_comparison(kValue);
+    }
+    else
+    {
+      parse_name();
+    }
+  }
+
+  /** A bare event name, short for comparing the type and code */
+  void parse_name()
+  {
+    int64_t type;
+    uint16_t ev_type;
+    uint16_t ev_code;
+    if (lookup_type(m_token, type))
+    {
+      emit(Op::kCompare, kType, kEq, type);
+    }
+    else if (evdev_lookup_code(m_token, ev_type, ev_code))
+    {
+      emit(Op::kCompare, kType, kEq, ev_type);
+      emit(Op::kCompare, kCode, kEq, ev_code);
+      emit(Op::kAnd);
+    }
+    else if (m_token.empty())
+    {
+      error("unexpected end");
+    }
+    else
+    {
+      error("unknown name '" + m_token + "'");
+    }
+    next();
+  }
+
+  void parse_comparison(Field field)
+  {
+    static const char* const cmps[] = { "==", "!=", "<", "<=", ">", ">=" };
+
+    if (m_token == "in")
+    {
+      next();
+      expect("{");
+      std::vector<int64_t> set;
+      set.push_back(parse_literal(field));
+      while(m_token == ",")
+      {
+        next();
+        set.push_back(parse_literal(field));
+      }
+      expect("}");
+
+      std::sort(set.begin(), set.end());
+      set.erase(std::unique(set.begin(), set.end()), set.end());
+      m_filter.m_sets.push_back(set);
+      emit(Op::kIn, field, kEq, static_cast<int64_t>(m_filter.m_sets.size() - 1));
+      return;
+    }
+
+    for(size_t i = 0; i < sizeof(cmps) / sizeof(cmps[0]); ++i)
+    {
+      if (m_token == cmps[i])
+      {
+        next();
+        const int64_t arg = parse_literal(field);
+        emit(Op::kCompare, field, static_cast<Cmp>(i), arg);
+        return;
+      }
+    }
+
+    error("expected a comparison");
+  }
+
+  int64_t parse_literal(Field field)
+  {
+    int64_t value = 0;
+    uint16_t ev_type;
+    uint16_t ev_code;
+
+    if (!m_token.empty() && (isdigit(static_cast<unsigned char>(m_token[0])) || m_token[0] == '-'))
+    {
+      char* end;
+      value = strtoll(m_token.c_str(), &end, 0);
+      if (*end != '\0')
+      {
+        error("invalid number '" + m_token + "'");
+      }
+    }
+    else if (field == kType && lookup_type(m_token, value))
+    {
+      // found
+    }
+    else if (field == kCode && evdev_lookup_code(m_token, ev_type, ev_code))
+    {
+      value = ev_code;
+    }
+    else
+    {
+      error("expected a number" + std::string(field == kType ? " or an EV_ name" :
+                                              field == kCode ? " or a code name" : ""));
+    }
+    next();
+    return value;
+  }
+
+private:
+  Parser(const Parser&) = delete;
+  Parser& operator=(const Parser&) = delete;
+};
+
+EventFilter::EventFilter() :
+  m_expr(),
+  m_program(),
+  m_sets(),
+  m_pass(),
+  m_check()
+{
+  compile();
+}
+
+EventFilter::EventFilter(const std::string& expr) :
+  m_expr(expr),
+  m_program(),
+  m_sets(),
+  m_pass(),
+  m_check()
+{
+  if (expr.find_first_not_of(" \t\n") != std::string::npos)
+  {
+    Parser(*this, expr).parse();
+  }
+  compile();
+}
+
+size_t
+EventFilter::filter(struct input_event* ev, size_t count, bool keep_syn) const
+{
+  size_t n = 0;
+  for(size_t i = 0; i < count; ++i)
+  {
+    if ((keep_syn && ev[i].type == EV_SYN) || accept(ev[i]))
+    {
+      ev[n++] = ev[i];
+    }
+  }
+  return n;
+}
+
+bool
+EventFilter::may_accept(uint16_t type, uint16_t code) const
+{
+  if (type < kNumTypes && code < kNumCodes)
+  {
+    const size_t idx = type * kNumCodes + code;
+    return bits::test_bit(idx, m_pass.data()) || bits::test_bit(idx, m_check.data());
+  }
+  else
+  {
+    return true;
+  }
+}
+
+bool
+EventFilter::test(const Op& op, const struct input_event& ev) const
+{
+  int64_t lhs;
+  switch(op.field)
+  {
+    case kType: lhs = ev.type; break;
+    case kCode: lhs = ev.code; break;
+    case kValue: lhs = ev.value; break;
+    default: lhs = ev.value < 0 ? -static_cast<int64_t>(ev.value) : ev.value; break;
+  }
+
+  if (op.kind == Op::kIn)
+  {
+    const std::vector<int64_t>& set = m_sets[static_cast<size_t>(op.arg)];
+    return std::binary_search(set.begin(), set.end(), lhs);
+  }
+  else
+  {
+    switch(op.cmp)
+    {
+      case kEq: return lhs == op.arg;
+      case kNe: return lhs != op.arg;
+      case kLt: return lhs < op.arg;
+      case kLe: return lhs <= op.arg;
+      case kGt: return lhs > op.arg;
+      default: return lhs >= op.arg;
+    }
+  }
+}
+
+bool
+EventFilter::eval(const struct input_event& ev) const
+{
+  if (m_program.empty())
+  {
+    return true;
+  }
+
+  bool stack[kMaxDepth];
+  size_t top = 0;
+
+  for(const Op& op : m_program)
+  {
+    switch(op.kind)
+    {
+      case Op::kCompare:
+      case Op::kIn:
+        stack[top++] = test(op, ev);
+        break;
+
+      case Op::kAnd:
+        --top;
+        stack[top - 1] = stack[top - 1] && stack[top];
+        break;
+
+      case Op::kOr:
+        --top;
+        stack[top - 1] = stack[top - 1] || stack[top];
+        break;
+
+      case Op::kNot:
+        stack[top - 1] = !stack[top - 1];
+        break;
+    }
+  }
+
+  return stack[0];
+}
+
+void
+EventFilter::compile()
+{
+  // check the stack depth once, so eval() doesn't have to
+  size_t depth = 0;
+  for(const Op& op : m_program)
+  {
+    if (op.kind == Op::kCompare || op.kind == Op::kIn)
+    {
+      if (++depth > kMaxDepth)
+      {
+        throw std::runtime_error("filter: expression too complex: " + m_expr);
+      }
+    }
+    else if (op.kind != Op::kNot)
+    {
+      --depth;
+    }
+  }
+
+  m_pass.assign(bits::nbits(kNumTypes * kNumCodes), 0);
+  m_check.assign(bits::nbits(kNumTypes * kNumCodes), 0);
+
+  // run the program for every type and code with an unknown value
+  std::vector<Tristate> stack(kMaxDepth);
+  for(size_t type = 0; type < kNumTypes; ++type)
+  {
+    for(size_t code = 0; code < kNumCodes; ++code)
+    {
+      struct input_event ev = {};
+      ev.type = static_cast<uint16_t>(type);
+      ev.code = static_cast<uint16_t>(code);
+
+      Tristate result = kTrue;
+      size_t top = 0;
+      for(const Op& op : m_program)
+      {
+        switch(op.kind)
+        {
+          case Op::kCompare:
+          case Op::kIn:
+            if (op.field == kType || op.field == kCode)
+            {
+              stack[top++] = test(op, ev) ? kTrue : kFalse;
+            }
+            else
+            {
+              stack[top++] = kUnknown;
+            }
+            break;
+
+          case Op::kAnd:
+            --top;
+            stack[top - 1] = tri_and(stack[top - 1], stack[top]);
+            break;
+
+          case Op::kOr:
+            --top;
+            stack[top - 1] = tri_or(stack[top - 1], stack[top]);
+            break;
+
+          case Op::kNot:
+            stack[top - 1] = tri_not(stack[top - 1]);
+            break;
+        }
+      }
+      if (top > 0)
+      {
+        result = stack[0];
+      }
+
+      const size_t idx = type * kNumCodes + code;
+      if (result == kTrue)
+      {
+        m_pass[bits::long_idx(idx)] |= bits::bit(idx);
+      }
+      else if (result == kUnknown)
+      {
+        m_check[bits::long_idx(idx)] |= bits::bit(idx);
+      }
+    }
+  }
+}
+
+/* EOF */
@@ -0,0 +1,120 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_EVENT_FILTER_HPP
+#define HEADER_EVENT_FILTER_HPP
+
+#include <linux/input.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "bits.hpp"
+
+/** A compiled filter expression like
+
+      type==EV_ABS && code in {ABS_X,ABS_Y} && |value|>100
+
+    The fields are type, code, value and |value|, compared with ==,
+    !=, <, <=, >, >= or "in {...}" against numbers or event names and
+    combined with &&, || and ! and parentheses. A bare name is short
+    for its type and code, "BTN_SOUTH || EV_REL" matches the south
+    button and all relative axes.
+
+    Whether a type and code can pass at all is worked out when the
+    filter is compiled, so most events are decided by a single bit
+    test and only those whose value matters run the predicate
+    program. */
+class EventFilter
+{
+private:
+  class Parser;
+
+  enum Field { kType, kCode, kValue, kAbsValue };
+  enum Cmp { kEq, kNe, kLt, kLe, kGt, kGe };
+
+  struct Op
+  {
+    enum Kind { kCompare, kIn, kAnd, kOr, kNot };
+
+    Kind kind;
+    Field field;
+    Cmp cmp;
+    // the operand of kCompare, the index into m_sets for kIn
+    int64_t arg;
+  };
+
+  // types and codes the bitmaps cover, anything beyond that always
+  // runs the program
+  static const size_t kNumTypes = EV_CNT;
+  static const size_t kNumCodes = KEY_CNT;
+
+  std::string m_expr;
+  std::vector<Op> m_program;
+  std::vector<std::vector<int64_t> > m_sets;
+
+  // type * kNumCodes + code -> passes whatever the value is
+  std::vector<unsigned long> m_pass;
+  // type * kNumCodes + code -> depends on the value
+  std::vector<unsigned long> m_check;
+
+public:
+  /** Matches every event */
+  EventFilter();
+
+  /** Throws std::runtime_error when \a expr doesn't parse, an empty
+      \a expr matches every event */
+  EventFilter(const std::string& expr);
+
+  bool accept(const struct input_event& ev) const
+  {
+    if (ev.type < kNumTypes && ev.code < kNumCodes)
+    {
+      const size_t idx = ev.type * kNumCodes + ev.code;
+      if (bits::test_bit(idx, m_pass.data()))
+      {
+        return true;
+      }
+      else if (!bits::test_bit(idx, m_check.data()))
+      {
+        return false;
+      }
+    }
+    return eval(ev);
+  }
+
+  /** Moves the accepted events to the front of \a ev and returns
+      their number, EV_SYN always gets accepted when \a keep_syn is
+      set, as consumers that track the device state need it */
+  size_t filter(struct input_event* ev, size_t count, bool keep_syn) const;
+
+  /** False when no event of \a type and \a code can pass the filter,
+      whatever its value */
+  bool may_accept(uint16_t type, uint16_t code) const;
+
+  bool empty() const { return m_program.empty(); }
+  const std::string& str() const { return m_expr; }
+
+private:
+  bool test(const Op& op, const struct input_event& ev) const;
+  bool eval(const struct input_event& ev) const;
+  void compile();
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,202 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string.h>
+
+#include "event_filter.hpp"
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const std::string& what)
+{
+  if (!ok)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    g_failures += 1;
+  }
+}
+
+struct input_event make_event(uint16_t type, uint16_t code, int32_t value)
+{
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  return ev;
+}
+
+int64_t abs64(int32_t value)
+{
+  return value < 0 ? -static_cast<int64_t>(value) : value;
+}
+
+/** An expression and what it has to mean */
+struct Case
+{
+  const char* expr;
+  bool (*expected)(uint16_t type, uint16_t code, int32_t value);
+};
+
+const Case kCases[] = {
+  { "",
+    [](uint16_t, uint16_t, int32_t) { return true; } },
+  { "type==EV_ABS && code in {ABS_X,ABS_Y} && |value|>100",
+    [](uint16_t t, uint16_t c, int32_t v) { return t == EV_ABS && (c == ABS_X || c == ABS_Y) && abs64(v) > 100; } },
+  // && binds tighter than ||
+  { "type==EV_KEY || type==EV_REL && value>0",
+    [](uint16_t t, uint16_t, int32_t v) { return t == EV_KEY || (t == EV_REL && v > 0); } },
+  { "(type==EV_KEY || type==EV_REL) && value>0",
+    [](uint16_t t, uint16_t, int32_t v) { return (t == EV_KEY || t == EV_REL) && v > 0; } },
+  // ! binds tighter than both
+  { "!EV_KEY && value>0",
+    [](uint16_t t, uint16_t, int32_t v) { return t != EV_KEY && v > 0; } },
+  { "!(EV_KEY && value>0)",
+    [](uint16_t t, uint16_t, int32_t v) { return !(t == EV_KEY && v > 0); } },
+  { "!BTN_SOUTH",
+    [](uint16_t t, uint16_t c, int32_t) { return !(t == EV_KEY && c == BTN_SOUTH); } },
+  { "!!EV_REL || !(value >= -100)",
+    [](uint16_t t, uint16_t, int32_t v) { return t == EV_REL || v < -100; } },
+  { "BTN_SOUTH || EV_REL",
+    [](uint16_t t, uint16_t c, int32_t) { return (t == EV_KEY && c == BTN_SOUTH) || t == EV_REL; } },
+  { "code != 0 && type in {1, 0x3}",
+    [](uint16_t t, uint16_t c, int32_t) { return c != 0 && (t == EV_KEY || t == EV_ABS); } },
+  { "value <= -101 || value == 200 || |value| < 1",
+    [](uint16_t, uint16_t, int32_t v) { return v <= -101 || v == 200 || v == 0; } },
+  { "type != EV_SYN && code < 2 || code >= ABS_Z && type == EV_ABS",
+    [](uint16_t t, uint16_t c, int32_t) { return (t != EV_SYN && c < 2) || (c >= ABS_Z && t == EV_ABS); } },
+};
+
+void test_cases()
+{
+  static const uint16_t types[] = { EV_SYN, EV_KEY, EV_REL, EV_ABS, EV_MSC, EV_SW, EV_LED, 0x1f };
+  // KEY_CNT is past the bitmaps and always runs the program
+  static const uint16_t codes[] = { 0, 1, ABS_X, ABS_Y, ABS_Z, REL_WHEEL, BTN_SOUTH, BTN_EAST, KEY_MAX, KEY_CNT };
+  static const int32_t values[] = { std::numeric_limits<int32_t>::min(), -200, -101, -100, -1, 0, 1,
+                                    100, 101, 200, std::numeric_limits<int32_t>::max() };
+
+  for(const Case& c : kCases)
+  {
+    const EventFilter filter(c.expr);
+    for(uint16_t type : types)
+    {
+      for(uint16_t code : codes)
+      {
+        bool any = false;
+        for(int32_t value : values)
+        {
+          const bool expected = c.expected(type, code, value);
+          if (filter.accept(make_event(type, code, value)) != expected)
+          {
+            check(false, std::string("'") + c.expr + "' on " + std::to_string(type) + ":" +
+                  std::to_string(code) + "=" + std::to_string(value));
+          }
+          any = any || expected;
+        }
+
+        // may_accept() may only rule out what can never pass
+        if (any && !filter.may_accept(type, code))
+        {
+          check(false, std::string("'") + c.expr + "' may_accept " +
+                std::to_string(type) + ":" + std::to_string(code));
+        }
+      }
+    }
+  }
+}
+
+void test_may_accept()
+{
+  const EventFilter axes("type==EV_ABS && code in {ABS_X,ABS_Y} && |value|>100");
+  check(axes.may_accept(EV_ABS, ABS_X), "may_accept ABS_X");
+  check(!axes.may_accept(EV_ABS, ABS_Z), "may_accept rules out ABS_Z");
+  check(!axes.may_accept(EV_KEY, BTN_SOUTH), "may_accept rules out keys");
+  check(axes.may_accept(EV_ABS, KEY_CNT), "may_accept past the bitmaps");
+
+  const EventFilter not_south("!BTN_SOUTH");
+  check(!not_south.may_accept(EV_KEY, BTN_SOUTH), "may_accept rules out the negated name");
+  check(not_south.may_accept(EV_KEY, BTN_EAST), "may_accept other keys");
+
+  const EventFilter all;
+  check(all.empty() && all.may_accept(EV_MSC, MSC_SCAN), "an empty filter accepts everything");
+}
+
+void test_filter()
+{
+  const EventFilter filter("EV_REL");
+  struct input_event ev[] = {
+    make_event(EV_KEY, BTN_LEFT, 1),
+    make_event(EV_REL, REL_X, 5),
+    make_event(EV_SYN, SYN_REPORT, 0),
+    make_event(EV_REL, REL_Y, -5),
+  };
+
+  struct input_event copy[4];
+  memcpy(copy, ev, sizeof(ev));
+  check(filter.filter(copy, 4, false) == 2, "filter without EV_SYN");
+  check(copy[0].code == REL_X && copy[1].code == REL_Y, "filter keeps the order");
+
+  memcpy(copy, ev, sizeof(ev));
+  check(filter.filter(copy, 4, true) == 3, "filter with EV_SYN");
+  check(copy[1].type == EV_SYN, "filter keeps EV_SYN in place");
+}
+
+void test_bad_expressions()
+{
+  static const char* const exprs[] = {
+    "type==", "&&", "!", "(type==EV_KEY", "type==EV_KEY)", "code in {ABS_X", "code in {}",
+    "code in ABS_X", "foo", "type === 1", "value > 10x", "|code| > 1", "|value > 1",
+    "type==ABS_X", "value == EV_KEY", "BTN_SOUTH BTN_EAST", "EV_KEY ||", "type ~ 1"
+  };
+
+  for(const char* expr : exprs)
+  {
+    try
+    {
+      EventFilter filter(expr);
+      check(false, std::string("'") + expr + "' accepted");
+    }
+    catch(const std::runtime_error&)
+    {
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  test_cases();
+  test_may_accept();
+  test_filter();
+  test_bad_expressions();
+
+  if (g_failures)
+  {
+    std::cerr << g_failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "all checks passed" << std::endl;
+  return 0;
+}
+
+/* EOF */
@@ -0,0 +1,67 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_EVENT_SOURCE_HPP
+#define HEADER_EVENT_SOURCE_HPP
+
+#include <string>
+#include <sys/types.h>
+
+#include "evdev_info.hpp"
+#include "evdev_snapshot.hpp"
+
+class EventFilter;
+
+/** Something that produces input events like an evdev device node:
+    a real device, a synthetic generator or a fake fed through a
+    pipe. */
+class EventSource
+{
+public:
+  EventSource() {}
+  virtual ~EventSource() {}
+
+  virtual EvdevInfo read_evdev_info() = 0;
+
+  /** Non-blocking, returns the number of events read, 0 when there
+      are none available or -1 on error */
+  virtual ssize_t read_events(struct input_event* ev, size_t count) = 0;
+
+  /** A file descriptor that becomes readable when read_events() has
+      events to return */
+  virtual int get_fd() const = 0;
+
+  /** Fill \a snapshot with the current state of the device, used to
+      recover from SYN_DROPPED. Returns false for sources that don't
+      know their state. */
+  virtual bool read_snapshot(EvdevSnapshot& snapshot) { return false; }
+
+  /** Ask the source to not produce the events that \a filter can't
+      accept, whatever their value, so they cost nothing to discard.
+      EV_SYN always gets through. Returns false when the source can't
+      do that, the filter still has to be applied to what it reads. */
+  virtual bool set_event_mask(const EventFilter& filter) { return false; }
+
+  virtual const std::string& get_filename() const = 0;
+
+private:
+  EventSource(const EventSource&) = delete;
+  EventSource& operator=(const EventSource&) = delete;
+};
+
+#endif
+
+/* EOF */
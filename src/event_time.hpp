@@ -0,0 +1,44 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_EVENT_TIME_HPP
+#define HEADER_EVENT_TIME_HPP
+
+#include <linux/input.h>
+#include <stdint.h>
+
+// older kernel headers only have the timeval member
+#ifndef input_event_sec
+#  define input_event_sec time.tv_sec
+#  define input_event_usec time.tv_usec
+#endif
+
+/** The timestamp of \a ev in microseconds */
+inline uint64_t get_event_usec(const struct input_event& ev)
+{
+  return static_cast<uint64_t>(ev.input_event_sec) * 1000000u +
+    static_cast<uint64_t>(ev.input_event_usec);
+}
+
+inline void set_event_usec(struct input_event& ev, uint64_t usec)
+{
+  ev.input_event_sec = static_cast<decltype(ev.input_event_sec)>(usec / 1000000u);
+  ev.input_event_usec = static_cast<decltype(ev.input_event_usec)>(usec % 1000000u);
+}
+
+#endif
+
+/* EOF */
@@ -0,0 +1,242 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "event_writer.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <stdexcept>
+#include <string.h>
+#include <unistd.h>
+
+#include "evdev_enum.hpp"
+#include "event_time.hpp"
+
+namespace {
+
+// longest line an event can produce, the names included
+const size_t kMaxLineLength = 256;
+
+} // namespace
+
+EventWriter::Format
+EventWriter::parse_format(const std::string& name)
+{
+  if (name == "text")
+  {
+    return kText;
+  }
+  else if (name == "csv")
+  {
+    return kCsv;
+  }
+  else if (name == "jsonl")
+  {
+    return kJsonl;
+  }
+  else
+  {
+    throw std::runtime_error("unknown output format: " + name);
+  }
+}
+
+EventWriter::EventWriter(int fd, Format format, size_t buffer_size) :
+  m_fd(fd),
+  m_format(format),
+  m_buffer(std::max(buffer_size, 2 * kMaxLineLength)),
+  m_size(0),
+  m_bytes(0)
+{
+}
+
+EventWriter::~EventWriter()
+{
+  try
+  {
+    flush();
+  }
+  catch(const std::exception& err)
+  {
+    // nothing left to report the error to
+  }
+}
+
+void
+EventWriter::write_header()
+{
+  if (m_format == kCsv)
+  {
+    append("time,type,code,value,type_name,code_name\n");
+  }
+}
+
+void
+EventWriter::write(const struct input_event& ev)
+{
+  reserve(kMaxLineLength);
+
+  switch(m_format)
+  {
+    case kText:
+      append_time(ev);
+      append(" ");
+      append(get_type_name(ev.type));
+      append(" ");
+      append(get_code_name(ev.type, ev.code));
+      append(" ");
+      append_int(ev.value);
+      append("\n");
+      break;
+
+    case kCsv:
+      append_time(ev);
+      append(",");
+      append_uint(ev.type);
+      append(",");
+      append_uint(ev.code);
+      append(",");
+      append_int(ev.value);
+      append(",");
+      append(get_type_name(ev.type));
+      append(",");
+      append(get_code_name(ev.type, ev.code));
+      append("\n");
+      break;
+
+    case kJsonl:
+      append("{\"time\":");
+      append_time(ev);
+      append(",\"type\":");
+      append_uint(ev.type);
+      append(",\"code\":");
+      append_uint(ev.code);
+      append(",\"value\":");
+      append_int(ev.value);
+      append(",\"name\":\"");
+      append(get_code_name(ev.type, ev.code));
+      append("\"}\n");
+      break;
+  }
+}
+
+void
+EventWriter::flush()
+{
+  size_t pos = 0;
+  while(pos < m_size)
+  {
+    ssize_t wr = ::write(m_fd, m_buffer.data() + pos, m_size - pos);
+    if (wr < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      m_size = 0;
+      throw std::runtime_error(std::string("write: ") + strerror(errno));
+    }
+    pos += static_cast<size_t>(wr);
+  }
+
+  m_bytes += m_size;
+  m_size = 0;
+}
+
+void
+EventWriter::reserve(size_t len)
+{
+  if (m_buffer.size() - m_size < len)
+  {
+    flush();
+  }
+}
+
+void
+EventWriter::append(const char* str, size_t len)
+{
+  // names come from the tables, a line can't get longer than
+  // kMaxLineLength, so reserve() made enough room
+  memcpy(m_buffer.data() + m_size, str, len);
+  m_size += len;
+}
+
+void
+EventWriter::append(const char* str)
+{
+  append(str, strlen(str));
+}
+
+void
+EventWriter::append_uint(uint64_t value)
+{
+  char digits[20];
+  size_t len = 0;
+  do
+  {
+    digits[len++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  while(value != 0);
+
+  while(len > 0)
+  {
+    m_buffer[m_size++] = digits[--len];
+  }
+}
+
+void
+EventWriter::append_int(int64_t value)
+{
+  if (value < 0)
+  {
+    append("-", 1);
+    append_uint(static_cast<uint64_t>(-(value + 1)) + 1);
+  }
+  else
+  {
+    append_uint(static_cast<uint64_t>(value));
+  }
+}
+
+void
+EventWriter::append_time(const struct input_event& ev)
+{
+  // seconds with the microseconds zero padded to six digits
+  const uint64_t usec = get_event_usec(ev);
+  append_uint(usec / 1000000u);
+  append(".", 1);
+
+  const uint64_t frac = usec % 1000000u;
+  for(uint64_t div = 100000; div > 0; div /= 10)
+  {
+    m_buffer[m_size++] = static_cast<char>('0' + (frac / div) % 10);
+  }
+}
+
+const char*
+EventWriter::get_type_name(uint16_t type) const
+{
+  const char* name = evdev_type_cname(type);
+  return name ? name : "EV_UNKNOWN";
+}
+
+const char*
+EventWriter::get_code_name(uint16_t type, uint16_t code) const
+{
+  const char* name = evdev_code_cname(type, code);
+  return name ? name : "UNKNOWN";
+}
+
+/* EOF */
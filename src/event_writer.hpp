@@ -0,0 +1,84 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HEADER_EVENT_WRITER_HPP
+#define HEADER_EVENT_WRITER_HPP
+
+#include <linux/input.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Formats events as text, CSV or JSON lines into a memory buffer
+    that is written out with a single write() once full or when
+    flush() is called, so a fast device costs neither a syscall nor
+    an allocation per event. */
+class EventWriter
+{
+public:
+  enum Format { kText, kCsv, kJsonl };
+
+  /** Parses "text", "csv" or "jsonl", throws on anything else */
+  static Format parse_format(const std::string& name);
+
+private:
+  int m_fd;
+  Format m_format;
+  std::vector<char> m_buffer;
+  size_t m_size;
+  uint64_t m_bytes;
+
+public:
+  /** Writes to \a fd, which is not closed by the EventWriter */
+  EventWriter(int fd, Format format, size_t buffer_size = 64 * 1024);
+  ~EventWriter();
+
+  /** The CSV column names, nothing for the other formats */
+  void write_header();
+
+  void write(const struct input_event& ev);
+  void write(const struct input_event* ev, size_t count)
+  {
+    for(size_t i = 0; i < count; ++i)
+    {
+      write(ev[i]);
+    }
+  }
+
+  /** Throws when the output can't be written */
+  void flush();
+
+  bool has_pending() const { return m_size > 0; }
+  uint64_t get_bytes() const { return m_bytes + m_size; }
+
+private:
+  void reserve(size_t len);
+  void append(const char* str, size_t len);
+  void append(const char* str);
+  void append_uint(uint64_t value);
+  void append_int(int64_t value);
+  void append_time(const struct input_event& ev);
+
+  const char* get_type_name(uint16_t type) const;
+  const char* get_code_name(uint16_t type, uint16_t code) const;
+
+private:
+  EventWriter(const EventWriter&) = delete;
+  EventWriter& operator=(const EventWriter&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -21,6 +21,7 @@
 
 #include "util.hpp"
 #include "evdev_widget.hpp"
+#include "synthetic_source.hpp"
 
 void EvtestApp::display_message(QString message)
 {
@@ -37,111 +38,329 @@ EvtestApp::EvtestApp() :
   m_widget(),
   m_vbox_layout(&m_widget),
   m_ev_widget(),
-  m_device(),
-  m_state(),
-  m_notifier(),
-  m_tested(false),
-  m_initialized_devices(false)
+  m_open_devices(),
+  m_reader(),
+  m_watcher(),
+  m_prober(),
+  m_sysfs(),
+  m_registry(m_sysfs),
+  m_initialized_devices(false),
+  m_frame_rate(60),
+  m_multi(false),
+  m_match(),
+  m_record_filename(),
+  m_latency(false),
+  m_filter(),
+  m_kernel_mask(false),
+  m_failed_filename(),
+  m_replaying(false)
 {
   //m_widget.setMinimumSize(400, 300);
   m_window.setCentralWidget(&m_widget);
 
   display_message("Please, plug in the device.");
 
+  m_reader = util::make_unique<EvdevReader>();
+  m_reader->set_frame_rate(m_frame_rate);
+  QObject::connect(m_reader.get(), SIGNAL(sig_ready()),
+                   this, SLOT(on_reader_ready()));
+  QObject::connect(&m_prober, SIGNAL(sig_ready()),
+                   this, SLOT(on_probe_ready()));
+
+  // connected before the first refresh_device_list(), which blocks
+  // them for the devices that are already plugged in
+  QObject::connect(&m_registry, SIGNAL(sig_device_added(QString const&)),
+                   this, SLOT(on_added_device(QString const&)));
+  QObject::connect(&m_registry, SIGNAL(sig_device_removed(QString const&)),
+                   this, SLOT(on_removed_device(QString const&)));
+  QObject::connect(&m_registry, SIGNAL(sig_device_changed(QString const&)),
+                   this, SLOT(on_replaced_device(QString const&)));
+
+  try
+  {
+    m_watcher = util::make_unique<EvdevWatcher>("/dev/input");
+
+    // only the node that inotify reported is looked at again
+    QObject::connect(m_watcher.get(), SIGNAL(sig_device_added(QString const&)),
+                     &m_registry, SLOT(update(QString const&)));
+    QObject::connect(m_watcher.get(), SIGNAL(sig_device_removed(QString const&)),
+                     &m_registry, SLOT(update(QString const&)));
+    QObject::connect(m_watcher.get(), SIGNAL(sig_device_changed(QString const&)),
+                     this, SLOT(on_changed_device(QString const&)));
+
+    // lost notifications are made up for by a full scan
+    QObject::connect(m_watcher.get(), SIGNAL(sig_overflow()),
+                     this, SLOT(refresh_device_list()));
+    QObject::connect(m_watcher.get(), SIGNAL(sig_failed()),
+                     this, SLOT(on_watcher_failed()));
+  }
+  catch(const std::exception& err)
+  {
+    std::cerr << "inotify not available, polling for devices: " << err.what() << std::endl;
+    start_polling();
+  }
+
+  m_window.show();
+}
+
+EvtestApp::~EvtestApp()
+{
+  close_all_devices();
+}
+
+void
+EvtestApp::start_polling()
+{
+  // no inotify, fall back to polling the device directory
   QTimer *timer = new QTimer(this);
   connect(timer, SIGNAL(timeout()), this, SLOT(refresh_device_list()));
   timer->start(1000);
-
-  m_window.show();
 }
 
+void
+EvtestApp::on_watcher_failed()
+{
+  std::cerr << "inotify failed, polling for devices" << std::endl;
 
+  // whatever happened since the last notification is only known
+  // from a full scan
+  refresh_device_list();
+  start_polling();
+}
 
-EvdevInfo EvtestApp::device_info(QString device)
+EvdevInfoPtr EvtestApp::device_info(QString device)
 {
     auto dev_fp = EvdevDevice::open(device.toStdString());
-    return dev_fp->read_evdev_info();
+    return m_prober.get_info_cache().get(*dev_fp);
 }
 
 void
 EvtestApp::refresh_device_list()
 {
-  std::vector<std::string> new_devices = EvdevList::scan("/dev/input");
-  for(auto dev : new_devices)
-  {
-    try
+  if (!m_initialized_devices) {
+    // the devices that are already plugged in aren't news
+    m_registry.blockSignals(true);
+    m_registry.scan();
+    m_registry.blockSignals(false);
+    m_initialized_devices = true;
+
+    // in multi device mode everything that is already plugged in
+    // gets tested too
+    if (m_multi)
     {
-      EvdevInfo info = device_info(QString::fromStdString(dev));
+      for (const auto& dev : m_registry.get_filenames())
+      {
+        if (matches(dev))
+        {
+          open_device(dev);
+        }
+      }
+    }
+    return;
+  }
+
+  // the registry reports the differences to the last scan
+  m_registry.scan();
+}
 
-      std::ostringstream str;
-      str << dev.substr(11) << ": " << info.name;
+void
+EvtestApp::set_frame_rate(int hz)
+{
+  m_frame_rate = hz;
+  m_reader->set_frame_rate(m_frame_rate);
+  for(auto& dev : m_open_devices)
+  {
+    dev->state->set_frame_rate(m_frame_rate);
+  }
+}
+
+void
+EvtestApp::set_multi_device(bool multi)
+{
+  if (m_multi != multi)
+  {
+    close_all_devices();
+    m_multi = multi;
+
+    if (m_multi)
+    {
+      m_ev_widget = util::make_unique<QTabWidget>();
+      m_vbox_layout.addWidget(m_ev_widget.get());
     }
-    catch(const std::exception& err)
+    else
     {
-      std::cout << dev << ": " << err.what() << std::endl;
-
-      std::ostringstream str;
-      str << dev.substr(11) << ": " << "[error: " << err.what() << "]";
+      display_message("Please, plug in the device.");
     }
-    QCoreApplication::processEvents();
   }
+}
 
-  if (!m_initialized_devices) {
-    m_devices = new_devices;
-    m_initialized_devices = true;
-    return;
+void
+EvtestApp::set_match(const std::string& match)
+{
+  m_match = match;
+}
+
+void
+EvtestApp::set_record_filename(const std::string& filename)
+{
+  m_record_filename = filename;
+}
+
+void
+EvtestApp::set_latency_enabled(bool enabled)
+{
+  m_latency = enabled;
+}
+
+void
+EvtestApp::set_filter(const std::string& expr)
+{
+  m_filter = EventFilter(expr);
+}
+
+void
+EvtestApp::set_kernel_mask(bool enabled)
+{
+  m_kernel_mask = enabled;
+}
+
+bool
+EvtestApp::matches(const std::string& filename)
+{
+  if (m_match.empty())
+  {
+    return true;
+  }
+
+  EvdevSysfs::Device sysfs_dev;
+  if (m_sysfs.read(filename, sysfs_dev))
+  {
+    return sysfs_dev.info.name.find(m_match) != std::string::npos;
   }
 
-  std::vector<std::string> added_devices, removed_devices;
-  std::set_difference(new_devices.begin(), new_devices.end(), m_devices.begin(), m_devices.end(),
-          std::inserter(added_devices, added_devices.begin()));
-  std::set_difference(m_devices.begin(), m_devices.end(), new_devices.begin(), new_devices.end(),
-          std::inserter(removed_devices, removed_devices.begin()));
-  m_devices = new_devices;
-  for (auto dev : added_devices)
-      on_added_device(QString::fromStdString(dev));
-  for (auto dev : removed_devices)
-      on_removed_device(QString::fromStdString(dev));
+  // no sysfs, the node has to be opened to learn its name
+  try
+  {
+    const EvdevInfoPtr info = device_info(QString::fromStdString(filename));
+    return info->name.find(m_match) != std::string::npos;
+  }
+  catch(const std::exception& err)
+  {
+    std::cout << filename << ": " << err.what() << std::endl;
+    return false;
+  }
 }
 
 void
 EvtestApp::select_device(const QString& device)
 {
-  m_tested = false;
-  on_device_change(device.toStdString());
+  open_device(device.toStdString());
+}
+
+EvtestApp::OpenDevice*
+EvtestApp::find_open_device(const std::string& filename) const
+{
+  for(const auto& dev : m_open_devices)
+  {
+    if (dev->filename == filename)
+    {
+      return dev.get();
+    }
+  }
+  return nullptr;
 }
 
 void
-EvtestApp::on_data(EvdevDevice& device, EvdevState& state)
+EvtestApp::on_data(OpenDevice& dev)
 {
-  if (m_tested)
-      return;
   std::array<struct input_event, 128> ev;
-  while(true)
+  size_t num_events;
+  while((num_events = dev.channel->pop(ev.data(), ev.size())) > 0)
   {
-    ssize_t num_events = device.read_events(ev.data(), ev.size());
-    if (num_events < 0)
+    if (dev.recorder)
     {
-      std::cout << "error: " << num_events << ": " << strerror(errno) << std::endl;
-      return;
+      dev.recorder->record(ev.data(), num_events);
     }
-    else if (num_events == 0)
+
+    // keep draining the ring after the test passed, so it can't
+    // overflow, but ignore the events
+    if (!dev.tested)
     {
-      EvdevWidget *evdev = qobject_cast<EvdevWidget *>(m_ev_widget.get());
-      if (evdev && evdev->all_tested()) {
-        display_message("PASS\nPlease unplug the device.");
-        m_tested = true;
+      for(size_t i = 0; i < num_events; ++i)
+      {
+        dev.state->update(ev[i]);
       }
-      return;
     }
-    else
+  }
+
+  if (dev.channel->has_error())
+  {
+    // the reader stopped polling the device for good, drop the
+    // channel so this is only handled once
+    std::cerr << "error: " << dev.filename << ": reading events failed, device disconnected" << std::endl;
+    print_channel_stats(dev);
+    m_reader->remove_device(*dev.channel);
+    dev.channel = nullptr;
+
+    if (dev.widget)
     {
-      for(ssize_t i = 0; i < num_events; ++i)
+      dev.widget->set_disconnected();
+      if (m_multi)
       {
-        state.update(ev[static_cast<size_t>(i)]);
+        QTabWidget* tabs = static_cast<QTabWidget*>(m_ev_widget.get());
+        tabs->setTabText(tabs->indexOf(dev.widget),
+                         QString::fromStdString("DISCONNECTED - " + dev.state->get_info().name));
       }
     }
   }
+
+  check_tested(dev);
+}
+
+void
+EvtestApp::check_tested(OpenDevice& dev)
+{
+  if (!dev.tested && dev.widget && dev.widget->all_tested())
+  {
+    dev.tested = true;
+
+    if (m_multi)
+    {
+      QTabWidget* tabs = static_cast<QTabWidget*>(m_ev_widget.get());
+      tabs->setTabText(tabs->indexOf(dev.widget),
+                       QString::fromStdString("PASS - " + dev.state->get_info().name));
+    }
+    else
+    {
+      display_message("PASS\nPlease unplug the device.");
+      dev.widget = nullptr;
+    }
+  }
+}
+
+void
+EvtestApp::on_reader_ready()
+{
+  for(auto& dev : m_open_devices)
+  {
+    if (dev->channel)
+    {
+      on_data(*dev);
+    }
+  }
+}
+
+void
+EvtestApp::on_replay_finished()
+{
+  for(auto& dev : m_open_devices)
+  {
+    if (dev->replay)
+    {
+      std::cout << dev->filename << ": replay finished" << std::endl;
+      check_tested(*dev);
+    }
+  }
 }
 
 void
@@ -151,54 +370,342 @@ EvtestApp::on_shrink_action()
 }
 
 void
-EvtestApp::on_notification(int fd)
+EvtestApp::print_channel_stats(const OpenDevice& dev)
 {
-  on_data(*m_device, *m_state);
+  std::cout << dev.filename << ": ring high-water mark "
+            << dev.channel->get_high_water_mark() << "/" << dev.channel->get_capacity()
+            << ", " << dev.channel->get_overflows() << " events overflowed" << std::endl;
+  std::cout << dev.filename << ": " << dev.channel->get_syn_dropped() << " SYN_DROPPED, "
+            << dev.channel->get_discarded() << " events discarded, "
+            << dev.channel->get_resyncs() << " resyncs" << std::endl;
 }
 
 void
-EvtestApp::on_device_change(const std::string& filename)
+EvtestApp::close_device(OpenDevice& dev)
 {
-  m_notifier.reset();
-  m_state.reset();
-  m_ev_widget.reset();
+  if (dev.channel)
+  {
+    print_channel_stats(dev);
+  }
 
-  try
+  if (dev.state->get_report_rate().get_count() > 0)
+  {
+    std::cout << dev.filename << ": report rate " << dev.state->get_report_rate().str() << std::endl;
+  }
+
+  if (dev.latency)
+  {
+    std::cout << dev.filename << ": latency " << dev.latency->str() << std::endl;
+  }
+
+  if (dev.recorder)
   {
-    m_device = EvdevDevice::open(filename);
-    auto info = m_device->read_evdev_info();
+    std::cout << dev.filename << ": recorded " << dev.recorder->get_event_count()
+              << " events in " << dev.recorder->get_bytes() << " bytes" << std::endl;
+  }
+
+  if (m_multi && dev.widget)
+  {
+    QTabWidget* tabs = static_cast<QTabWidget*>(m_ev_widget.get());
+    tabs->removeTab(tabs->indexOf(dev.widget));
+    delete dev.widget;
+  }
 
-    m_state = util::make_unique<EvdevState>(info);
+  if (dev.channel)
+  {
+    m_reader->remove_device(*dev.channel);
+  }
+
+  m_open_devices.erase(std::remove_if(m_open_devices.begin(), m_open_devices.end(),
+                                      [&dev](const std::unique_ptr<OpenDevice>& d) {
+                                        return d.get() == &dev;
+                                      }),
+                       m_open_devices.end());
+}
 
-    m_ev_widget = util::make_unique<EvdevWidget>(*m_state, info);
+void
+EvtestApp::close_all_devices()
+{
+  while(!m_open_devices.empty())
+  {
+    close_device(*m_open_devices.back());
+  }
+}
+
+void
+EvtestApp::add_device_widget(OpenDevice& dev, const std::string& title)
+{
+  auto widget = util::make_unique<EvdevWidget>(*dev.state, dev.state->get_info());
+  dev.widget = widget.get();
+  if (m_multi)
+  {
+    QTabWidget* tabs = static_cast<QTabWidget*>(m_ev_widget.get());
+    tabs->addTab(widget.release(), QString::fromStdString(title));
+  }
+  else
+  {
+    m_ev_widget = std::move(widget);
     m_vbox_layout.addWidget(m_ev_widget.get());
+  }
+}
 
-    m_notifier = util::make_unique<QSocketNotifier>(m_device->get_fd(), QSocketNotifier::Read);
+void
+EvtestApp::open_replay(const std::string& filename, double speed)
+{
+  if (!m_multi)
+  {
+    close_all_devices();
+    m_ev_widget.reset();
+    m_replaying = true;
+  }
 
-    QObject::connect(m_notifier.get(), SIGNAL(activated(int)),
-                     this, SLOT(on_notification(int)));
+  try
+  {
+    auto dev = util::make_unique<OpenDevice>();
+    dev->filename = filename;
+    dev->replay = util::make_unique<EvdevReplay>(filename);
+    dev->replay->set_speed(speed);
+
+    dev->state = util::make_unique<EvdevState>(dev->replay->get_info());
+    dev->state->set_frame_rate(m_frame_rate);
+
+    add_device_widget(*dev, "replay: " + dev->replay->get_info()->name);
+
+    QObject::connect(dev->replay.get(), SIGNAL(sig_finished()),
+                     this, SLOT(on_replay_finished()));
+    dev->replay->start(*dev->state);
+    m_open_devices.push_back(std::move(dev));
 
     QTimer::singleShot(0, this, SIGNAL(on_shrink_action()));
   }
   catch(const std::exception& err)
   {
     std::cout << filename << ": " << err.what() << std::endl;
-    m_ev_widget = util::make_unique<QLabel>(err.what());
-    m_vbox_layout.addWidget(m_ev_widget.get());
+    if (!m_multi)
+    {
+      m_ev_widget = util::make_unique<QLabel>(err.what());
+      m_vbox_layout.addWidget(m_ev_widget.get());
+    }
   }
 }
 
+void
+EvtestApp::open_device(const std::string& filename)
+{
+  if (find_open_device(filename))
+  {
+    return;
+  }
+
+  // finished in finish_open_device(), the GUI keeps running while
+  // the device is being opened and probed
+  m_prober.probe(filename);
+}
+
+void
+EvtestApp::finish_open_device(EvdevProber::Result& result)
+{
+  const std::string& filename = result.filename;
+  if (find_open_device(filename))
+  {
+    return;
+  }
+
+  if (!m_multi)
+  {
+    close_all_devices();
+    m_ev_widget.reset();
+    m_replaying = false;
+  }
+
+  try
+  {
+    if (!result.device)
+    {
+      throw std::runtime_error(result.error);
+    }
+
+    const EvdevInfoCache& cache = m_prober.get_info_cache();
+    std::cout << filename << ": probed in " << result.usec / 1000 << " ms, probe cache: "
+              << cache.get_hits() << " hits, " << cache.get_misses() << " misses" << std::endl;
+
+    const std::string title = filename.substr(filename.rfind('/') + 1) + ": " + result.info->name;
+    open_source(std::move(result.device), result.info, title,
+                result.has_snapshot ? &result.snapshot : nullptr);
+    m_failed_filename.clear();
+  }
+  catch(const std::exception& err)
+  {
+    std::cout << filename << ": " << err.what() << std::endl;
+    if (!m_multi)
+    {
+      m_failed_filename = filename;
+      m_ev_widget = util::make_unique<QLabel>(err.what());
+      m_vbox_layout.addWidget(m_ev_widget.get());
+    }
+  }
+}
+
+void
+EvtestApp::on_probe_ready()
+{
+  for(auto& result : m_prober.take_results())
+  {
+    finish_open_device(*result);
+  }
+}
+
+void
+EvtestApp::open_synthetic(const std::string& spec)
+{
+  if (!m_multi)
+  {
+    close_all_devices();
+    m_ev_widget.reset();
+    m_replaying = true;
+  }
+
+  try
+  {
+    const std::string::size_type colon = spec.find(':');
+    const SyntheticSource::Profile profile = SyntheticSource::parse_profile(spec.substr(0, colon));
+    const int rate = colon != std::string::npos ? std::stoi(spec.substr(colon + 1)) : 1000;
+
+    auto source = util::make_unique<SyntheticSource>(profile, rate);
+    EvdevInfoPtr info = std::make_shared<const EvdevInfo>(source->read_evdev_info());
+    const std::string title = source->get_filename();
+    open_source(std::move(source), std::move(info), title);
+  }
+  catch(const std::exception& err)
+  {
+    std::cout << spec << ": " << err.what() << std::endl;
+    if (!m_multi)
+    {
+      m_ev_widget = util::make_unique<QLabel>(err.what());
+      m_vbox_layout.addWidget(m_ev_widget.get());
+    }
+  }
+}
+
+void
+EvtestApp::open_source(std::unique_ptr<EventSource> source, EvdevInfoPtr info,
+                       const std::string& title, const EvdevSnapshot* snapshot)
+{
+  const std::string& filename = source->get_filename();
+
+  auto dev = util::make_unique<OpenDevice>();
+  dev->filename = filename;
+  dev->state = util::make_unique<EvdevState>(info);
+  dev->state->set_frame_rate(m_frame_rate);
+
+  {
+    const MemoryUsage state_usage = dev->state->get_memory_usage();
+    const MemoryUsage info_usage = info->get_memory_usage();
+    // a probed device shares the capabilities with the probe cache,
+    // only the state is its own
+    std::cout << filename << ": " << DeviceClass::name(dev->state->get_device_class())
+              << ", memory: state " << state_usage.bytes << " bytes in "
+              << state_usage.allocations << " allocations, capabilities "
+              << info_usage.bytes << " bytes in " << info_usage.allocations
+              << " allocations" << std::endl;
+  }
+
+  if (!m_record_filename.empty())
+  {
+    std::string record_filename = m_record_filename;
+    if (m_multi)
+    {
+      record_filename += "." + filename.substr(filename.rfind('/') + 1);
+    }
+    dev->recorder = util::make_unique<EvdevRecorder>(record_filename, *info);
+  }
+
+  if (m_latency)
+  {
+    dev->latency = util::make_unique<LatencyTracker>();
+    dev->state->set_latency_tracker(dev->latency.get());
+  }
+
+  add_device_widget(*dev, title);
+
+  if (m_kernel_mask && !m_filter.empty() && !source->set_event_mask(m_filter))
+  {
+    std::cout << filename << ": kernel side filtering not supported" << std::endl;
+  }
+
+  // start from the actual device state, so that axes that don't
+  // rest at 0 and keys held while plugging in show up right away,
+  // probed devices come with a snapshot taken by the EvdevProber
+  EvdevSnapshot own_snapshot;
+  if (!snapshot && source->read_snapshot(own_snapshot))
+  {
+    snapshot = &own_snapshot;
+  }
+  if (snapshot)
+  {
+    dev->state->set_snapshot(*snapshot);
+  }
+
+  dev->channel = &m_reader->add_device(*source, dev->latency.get(),
+                                       snapshot,
+                                       &m_filter);
+  dev->source = std::move(source);
+
+  dev->widget->set_channel(dev->channel);
+  if (dev->latency)
+  {
+    dev->widget->set_latency_tracker(dev->latency.get());
+  }
+  m_open_devices.push_back(std::move(dev));
+
+  QTimer::singleShot(0, this, SIGNAL(on_shrink_action()));
+}
+
 void EvtestApp::on_added_device(const QString &device)
 {
   std::cout << "Added device:" << device.toStdString() << std::endl;
-  select_device(device);
+
+  const std::string filename = device.toStdString();
+  if (!m_replaying && matches(filename))
+  {
+    select_device(device);
+  }
 }
 
 void EvtestApp::on_removed_device(const QString &device)
 {
   std::cout << "Removed device:" << device.toStdString() << std::endl;
-  display_message("Please, plug in the device.");
 
+  const std::string filename = device.toStdString();
+  m_prober.get_info_cache().erase(filename);
+
+  OpenDevice* dev = find_open_device(filename);
+  if (dev)
+  {
+    close_device(*dev);
+    if (!m_multi)
+    {
+      display_message("Please, plug in the device.");
+    }
+  }
+}
+
+void EvtestApp::on_replaced_device(const QString &device)
+{
+  // the node got reused by a different device before the old one was
+  // noticed to be gone, treat it as unplug and plug
+  on_removed_device(device);
+  on_added_device(device);
+}
+
+void EvtestApp::on_changed_device(const QString &device)
+{
+  // udev often fixes up the permissions only after the node got
+  // created, so retry a device that couldn't be opened before
+  if (!m_failed_filename.empty() && device.toStdString() == m_failed_filename)
+  {
+    select_device(device);
+  }
 }
 
 /* EOF */
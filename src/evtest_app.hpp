@@ -24,6 +24,7 @@
 #include <QLayout>
 #include <QMainWindow>
 #include <QSocketNotifier>
+#include <QTabWidget>
 #include <QVBoxLayout>
 #include <QComboBox>
 
@@ -38,52 +39,173 @@
 #include "button_widget.hpp"
 #include "evdev_device.hpp"
 #include "evdev_enum.hpp"
+#include "evdev_info_cache.hpp"
 #include "evdev_list.hpp"
+#include "evdev_prober.hpp"
+#include "evdev_reader.hpp"
+#include "evdev_registry.hpp"
+#include "evdev_recorder.hpp"
+#include "evdev_replay.hpp"
 #include "evdev_state.hpp"
+#include "evdev_sysfs.hpp"
+#include "evdev_watcher.hpp"
+#include "event_filter.hpp"
+#include "event_source.hpp"
+#include "latency_tracker.hpp"
 
 class EvdevState;
 class EvdevDevice;
+class EvdevWidget;
 
 class EvtestApp : public QObject
 {
   Q_OBJECT
 
+private:
+  /** A device that is currently being tested */
+  class OpenDevice
+  {
+  public:
+    std::string filename;
+    std::unique_ptr<EventSource> source;
+    std::unique_ptr<EvdevState> state;
+    EvdevReader::Channel* channel;
+    EvdevWidget* widget;
+    std::unique_ptr<EvdevRecorder> recorder;
+    std::unique_ptr<LatencyTracker> latency;
+
+    // set instead of source and channel when playing a recording
+    std::unique_ptr<EvdevReplay> replay;
+
+    bool tested;
+
+    OpenDevice() :
+      filename(),
+      source(),
+      state(),
+      channel(),
+      widget(),
+      recorder(),
+      latency(),
+      replay(),
+      tested(false)
+    {}
+
+  private:
+    OpenDevice(const OpenDevice&) = delete;
+    OpenDevice& operator=(const OpenDevice&) = delete;
+  };
+
 private:
   QMainWindow m_window;
   QWidget m_widget;
 
   QVBoxLayout m_vbox_layout;
 
+  // the EvdevWidget or a message in single device mode, a
+  // QTabWidget with one tab per device in multi device mode
   std::unique_ptr<QWidget> m_ev_widget;
 
-  std::unique_ptr<EvdevDevice> m_device;
-  std::unique_ptr<EvdevState> m_state;
-  std::unique_ptr<QSocketNotifier> m_notifier;
+  std::vector<std::unique_ptr<OpenDevice> > m_open_devices;
+
+  // declared after m_open_devices, so the reader thread is stopped
+  // before the devices get closed
+  std::unique_ptr<EvdevReader> m_reader;
+
+  std::unique_ptr<EvdevWatcher> m_watcher;
+  EvdevProber m_prober;
+  EvdevSysfs m_sysfs;
+  EvdevRegistry m_registry;
 
-  std::vector<std::string> m_devices;
-  bool m_tested;
   bool m_initialized_devices;
+  int m_frame_rate;
+
+  bool m_multi;
+  std::string m_match;
+  std::string m_record_filename;
+  bool m_latency;
+  EventFilter m_filter;
+  bool m_kernel_mask;
+
+  // the device that failed to open in single device mode, retried
+  // when its permissions change
+  std::string m_failed_filename;
+
+  // don't let hotplug replace a replay or synthetic device in single
+  // device mode
+  bool m_replaying;
 
 public:
   EvtestApp();
+  virtual ~EvtestApp();
+
+  void set_frame_rate(int hz);
+
+  /** Test all matching devices at the same time, each one in its
+      own tab, instead of replacing the device on every hotplug */
+  void set_multi_device(bool multi);
+
+  /** Only pick up hotplugged devices whose name contains \a match,
+      empty matches everything */
+  void set_match(const std::string& match);
+
+  /** Record the events of every opened device to \a filename, in
+      multi device mode the node name gets appended */
+  void set_record_filename(const std::string& filename);
+
+  /** Measure the latency from the kernel to the screen for every
+      device opened afterwards */
+  void set_latency_enabled(bool enabled);
+
+  /** Only display and record the events matching the EventFilter
+      expression \a expr, throws when it doesn't parse */
+  void set_filter(const std::string& expr);
+
+  /** Have the kernel drop the events the filter rejects before they
+      get queued, see EventSource::set_event_mask() */
+  void set_kernel_mask(bool enabled);
 
   void select_device(const QString& device);
 
+  /** Play back a recording made with --record instead of testing a
+      real device, see EvdevReplay::set_speed() for \a speed */
+  void open_replay(const std::string& filename, double speed);
+
+  /** Test a synthetic device, \a spec is "PROFILE[:HZ]" with a
+      profile of SyntheticSource::parse_profile() */
+  void open_synthetic(const std::string& spec);
+
   void display_message(QString message);
 
 private:
-  void on_data(EvdevDevice& device, EvdevState& state);
-  void on_device_change(const std::string& filename);
+  void open_source(std::unique_ptr<EventSource> source, EvdevInfoPtr info,
+                   const std::string& title, const EvdevSnapshot* snapshot = nullptr);
+  void on_data(OpenDevice& dev);
+  void check_tested(OpenDevice& dev);
+  void add_device_widget(OpenDevice& dev, const std::string& title);
+  void open_device(const std::string& filename);
+  void finish_open_device(EvdevProber::Result& result);
+  void print_channel_stats(const OpenDevice& dev);
+  void close_device(OpenDevice& dev);
+  void close_all_devices();
+  OpenDevice* find_open_device(const std::string& filename) const;
+  bool matches(const std::string& filename);
+  void start_polling();
+
+  EvdevInfoPtr device_info(QString device);
 
+public slots:
   void on_added_device(const QString& device);
   void on_removed_device(const QString& device);
+  void on_replaced_device(const QString& device);
+  void on_changed_device(const QString& device);
+  void on_watcher_failed();
 
-  EvdevInfo device_info(QString device);
-
-public slots:
   void refresh_device_list();
   void on_shrink_action();
-  void on_notification(int);
+  void on_reader_ready();
+  void on_probe_ready();
+  void on_replay_finished();
 
 private:
   EvtestApp(const EvtestApp&) = delete;
@@ -17,28 +17,150 @@
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 
+import os
 import re
 
 
-def gen_event_list(rgx, outfilename):
+# newer kernels moved the codes out of input.h
+HEADERS = ["/usr/include/linux/input-event-codes.h",
+           "/usr/include/linux/input.h"]
+
+# table name -> the prefixes of the codes that go into it
+TABLES = [
+    ("ev", ["EV"]),
+    ("syn", ["SYN"]),
+    ("key", ["KEY", "BTN"]),
+    ("rel", ["REL"]),
+    ("abs", ["ABS"]),
+    ("msc", ["MSC"]),
+    ("sw", ["SW"]),
+    ("led", ["LED"]),
+    ("snd", ["SND"]),
+    ("rep", ["REP"]),
+]
+
+# prefix -> event type, for the name -> code hash
+TYPES = [
+    ("SYN", "EV_SYN"),
+    ("KEY", "EV_KEY"),
+    ("BTN", "EV_KEY"),
+    ("REL", "EV_REL"),
+    ("ABS", "EV_ABS"),
+    ("MSC", "EV_MSC"),
+    ("SW", "EV_SW"),
+    ("LED", "EV_LED"),
+]
+
+EXCLUDE = re.compile(r'(_MAX|_CNT)$|^EV_VERSION$')
+
+
+def read_defines():
+    """Returns [(name, value)] in header order, value is an int for
+    literals and the aliased name for aliases"""
+    path = next(p for p in HEADERS if os.path.exists(p))
+    defines = []
+    with open(path, 'r') as fin:
+        for line in fin:
+            m = re.match(r'^#define\s+([A-Z][A-Z0-9_]*)\s+(0x[0-9a-fA-F]+|[0-9]+|[A-Z][A-Z0-9_]*)\b', line)
+            if m and not EXCLUDE.search(m.group(1)):
+                value = m.group(2)
+                defines.append((m.group(1), int(value, 0) if value[0].isdigit() else value))
+    return path, defines
+
+
+def build_table(defines, prefixes):
+    """code -> canonical name, the last name defined with a literal
+    wins, so BTN_SOUTH beats the BTN_GAMEPAD range marker and BTN_0
+    beats BTN_MISC, aliases like BTN_A never replace their target"""
+    table = {}
+    for name, value in defines:
+        if name.split('_')[0] in prefixes and isinstance(value, int):
+            table[value] = name
+    return table
+
+
+def resolve(defines):
+    """Returns [(name, code)] with the aliases resolved"""
+    values = {}
+    for name, value in defines:
+        values[name] = value if isinstance(value, int) else values.get(value)
+    return [(name, values[name]) for name, _ in defines if values[name] is not None]
+
+
+def fnv1a(name, seed):
+    """Must match name_hash() in evdev_enum.cpp"""
+    h = (2166136261 ^ seed) & 0xffffffff
+    for c in name.encode('ascii'):
+        h ^= c
+        h = (h * 16777619) & 0xffffffff
+    return h
+
+
+def build_perfect_hash(keys):
+    """Hash and displace: every key goes to bucket fnv1a(key, 0) %
+    num_buckets, then each bucket, biggest first, gets the smallest
+    seed that moves all its keys to free slots with fnv1a(key, seed) %
+    len(keys). Returns (seeds, slots)."""
+    num_buckets = max(1, len(keys) // 4)
+    buckets = [[] for _ in range(num_buckets)]
+    for key in keys:
+        buckets[fnv1a(key, 0) % num_buckets].append(key)
+
+    seeds = [0] * num_buckets
+    slots = [None] * len(keys)
+    for b in sorted(range(num_buckets), key=lambda i: -len(buckets[i])):
+        if not buckets[b]:
+            continue
+        seed = 1
+        while True:
+            idx = [fnv1a(key, seed) % len(keys) for key in buckets[b]]
+            if len(set(idx)) == len(idx) and all(slots[i] is None for i in idx):
+                break
+            seed += 1
+        seeds[b] = seed
+        for key, i in zip(buckets[b], idx):
+            slots[i] = key
+    return seeds, slots
+
+
+def gen_event_names(outfilename):
+    path, defines = read_defines()
+
     with open(outfilename, 'w') as fout:
-        fout.write("// autogenerated by gen_event_list.rb, do not edit by hand\n\n")
+        fout.write("// autogenerated by gen_event_lists.py from {}, do not edit by hand\n\n".format(
+            os.path.basename(path)))
+
+        for table_name, prefixes in TABLES:
+            table = build_table(defines, prefixes)
+            size = max(table) + 1
+            fout.write("constexpr const char* const {}_names[{}] = {{\n".format(table_name, size))
+            for code in range(size):
+                if code in table:
+                    fout.write("  /* 0x{:03x} */ \"{}\",\n".format(code, table[code]))
+                else:
+                    fout.write("  /* 0x{:03x} */ nullptr,\n".format(code))
+            fout.write("};\n\n")
+
+        types = dict(TYPES)
+        codes = dict((name, code) for name, code in resolve(defines)
+                     if name.split('_')[0] in types)
+        seeds, slots = build_perfect_hash(sorted(codes))
+
+        fout.write("constexpr uint16_t name_hash_seeds[{}] = {{\n".format(len(seeds)))
+        for i in range(0, len(seeds), 12):
+            fout.write("  " + " ".join("{},".format(seed) for seed in seeds[i:i + 12]) + "\n")
+        fout.write("};\n\n")
 
-        with open("/usr/include/linux/input.h", 'r') as fin:
-            for line in [l for l in fin.readlines() if re.search(rgx, l)]:
-                name = line.split()[1]
-                if not re.search(r'(_MAX|_CNT)$', name):
-                    fout.write("#ifdef {}\n".format(name))
-                    fout.write("  add({}, \"{}\");\n".format(name, name))
-                    fout.write("#endif\n\n")
+        fout.write("constexpr NameHashEntry name_hash_entries[{}] = {{\n".format(len(slots)))
+        for name in slots:
+            fout.write("  {{ \"{}\", {}, 0x{:03x} }},\n".format(name, types[name.split('_')[0]], codes[name]))
+        fout.write("};\n\n")
 
         fout.write("/* EOF */\n")
 
 
 if __name__ == "__main__":
-    gen_event_list(r'^#define (BTN|KEY)', 'key_list.x')
-    gen_event_list(r'^#define REL', 'rel_list.x')
-    gen_event_list(r'^#define ABS', 'abs_list.x')
+    gen_event_names('evdev_names.x')
 
 
 # EOF #
@@ -0,0 +1,119 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const unsigned kSubBits = 5;
+const uint64_t kSubCount = 1u << kSubBits;
+const uint64_t kHalfSubCount = kSubCount / 2;
+
+unsigned highest_bit(uint64_t value)
+{
+  return 63u - static_cast<unsigned>(__builtin_clzll(value));
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() :
+  m_buckets(),
+  m_count(0),
+  m_max(0)
+{
+  reset();
+}
+
+size_t
+LatencyHistogram::bucket_index(uint64_t usec)
+{
+  if (usec < kSubCount)
+  {
+    return static_cast<size_t>(usec);
+  }
+  else
+  {
+    usec = std::min<uint64_t>(usec, 0xffffffffu);
+    const unsigned shift = highest_bit(usec) - (kSubBits - 1);
+    return static_cast<size_t>(shift * kHalfSubCount + (usec >> shift));
+  }
+}
+
+uint64_t
+LatencyHistogram::bucket_upper_bound(size_t idx)
+{
+  if (idx < kSubCount)
+  {
+    return idx;
+  }
+  else
+  {
+    const unsigned shift = static_cast<unsigned>(idx / kHalfSubCount - 1);
+    const uint64_t sub = idx % kHalfSubCount + kHalfSubCount;
+    return ((sub + 1) << shift) - 1;
+  }
+}
+
+void
+LatencyHistogram::record(uint64_t usec)
+{
+  m_buckets[bucket_index(usec)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t max = m_max.load(std::memory_order_relaxed);
+  while(usec > max &&
+        !m_max.compare_exchange_weak(max, usec, std::memory_order_relaxed))
+  {
+  }
+}
+
+void
+LatencyHistogram::reset()
+{
+  for(auto& bucket : m_buckets)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  m_count.store(0, std::memory_order_relaxed);
+  m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t
+LatencyHistogram::get_percentile(double percentile) const
+{
+  const uint64_t count = get_count();
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(static_cast<double>(count) * percentile / 100.0)));
+  uint64_t seen = 0;
+  for(size_t idx = 0; idx < kBucketCount; ++idx)
+  {
+    seen += m_buckets[idx].load(std::memory_order_relaxed);
+    if (seen >= rank)
+    {
+      // the bucket bound can overshoot the largest recorded value
+      return std::min(bucket_upper_bound(idx), get_max());
+    }
+  }
+  return get_max();
+}
+
+/* EOF */
@@ -0,0 +1,63 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HEADER_LATENCY_HISTOGRAM_HPP
+#define HEADER_LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Counts latencies in microseconds in fixed HDR style buckets: exact
+    below 32 us, above that 16 linear buckets per power of two, which
+    keeps the relative error under 6.25% with a few KiB of memory and
+    no allocation. record() may be called from one thread while
+    another one reads the statistics. */
+class LatencyHistogram
+{
+public:
+  // values at or above 2^32 us (~71 minutes) land in the last bucket
+  static const size_t kBucketCount = 464;
+
+private:
+  std::array<std::atomic<uint64_t>, kBucketCount> m_buckets;
+  std::atomic<uint64_t> m_count;
+  std::atomic<uint64_t> m_max;
+
+public:
+  LatencyHistogram();
+
+  void record(uint64_t usec);
+  void reset();
+
+  uint64_t get_count() const { return m_count.load(std::memory_order_relaxed); }
+  uint64_t get_max() const { return m_max.load(std::memory_order_relaxed); }
+
+  /** The value below which \a percentile percent of the recorded
+      values lie, rounded up to the upper end of its bucket */
+  uint64_t get_percentile(double percentile) const;
+
+  static size_t bucket_index(uint64_t usec);
+  static uint64_t bucket_upper_bound(size_t idx);
+
+private:
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,114 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "latency_tracker.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <time.h>
+
+namespace {
+
+void format_usec(std::ostream& out, uint64_t usec)
+{
+  out << std::fixed << std::setprecision(2) << static_cast<double>(usec) / 1000.0 << "ms";
+}
+
+} // namespace
+
+const char*
+LatencyTracker::get_stage_name(Stage stage)
+{
+  switch(stage)
+  {
+    case kRead: return "read";
+    case kUpdate: return "update";
+    case kDispatch: return "dispatch";
+    case kPaint: return "paint";
+    default: return "unknown";
+  }
+}
+
+uint64_t
+LatencyTracker::now_usec()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000u + static_cast<uint64_t>(ts.tv_nsec) / 1000u;
+}
+
+LatencyTracker::LatencyTracker() :
+  m_histograms(),
+  m_unpainted_usec(0)
+{
+}
+
+void
+LatencyTracker::dispatched(uint64_t event_usec, uint64_t now)
+{
+  record(kDispatch, event_usec, now);
+  if (m_unpainted_usec == 0)
+  {
+    m_unpainted_usec = event_usec;
+  }
+}
+
+void
+LatencyTracker::painted(uint64_t now)
+{
+  if (m_unpainted_usec != 0)
+  {
+    record(kPaint, m_unpainted_usec, now);
+    m_unpainted_usec = 0;
+  }
+}
+
+void
+LatencyTracker::reset()
+{
+  for(auto& histogram : m_histograms)
+  {
+    histogram.reset();
+  }
+  m_unpainted_usec = 0;
+}
+
+std::string
+LatencyTracker::str() const
+{
+  std::ostringstream out;
+  for(int i = 0; i < kStageCount; ++i)
+  {
+    const LatencyHistogram& histogram = m_histograms[i];
+    if (histogram.get_count() == 0)
+    {
+      continue;
+    }
+
+    if (out.tellp() > 0)
+    {
+      out << "  ";
+    }
+    out << get_stage_name(static_cast<Stage>(i)) << " p50 ";
+    format_usec(out, histogram.get_percentile(50.0));
+    out << " p99 ";
+    format_usec(out, histogram.get_percentile(99.0));
+    out << " max ";
+    format_usec(out, histogram.get_max());
+  }
+  return out.str();
+}
+
+/* EOF */
@@ -0,0 +1,79 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HEADER_LATENCY_TRACKER_HPP
+#define HEADER_LATENCY_TRACKER_HPP
+
+#include <string>
+#include <stdint.h>
+
+#include "latency_histogram.hpp"
+
+/** Measures how long events take from the kernel timestamp to each
+    stage of the pipeline. All stages use CLOCK_MONOTONIC, which
+    EvdevDevice switches the device clock to. Components take a
+    LatencyTracker pointer that is null when measuring is turned off,
+    so the cost is a branch per event. */
+class LatencyTracker
+{
+public:
+  enum Stage
+  {
+    kRead,      // read() by the EvdevReader thread
+    kUpdate,    // EvdevState::update()
+    kDispatch,  // sig_change delivered to the widgets
+    kPaint,     // paintEvent of a widget showing the change
+    kStageCount
+  };
+
+  static const char* get_stage_name(Stage stage);
+
+  /** CLOCK_MONOTONIC in microseconds */
+  static uint64_t now_usec();
+
+private:
+  LatencyHistogram m_histograms[kStageCount];
+
+  // kernel timestamp of the oldest event that was dispatched but not
+  // painted yet, 0 when everything is painted, GUI thread only
+  uint64_t m_unpainted_usec;
+
+public:
+  LatencyTracker();
+
+  void record(Stage stage, uint64_t event_usec, uint64_t now)
+  {
+    m_histograms[stage].record(now > event_usec ? now - event_usec : 0);
+  }
+
+  /** Called after a frame with events starting at \a event_usec was
+      dispatched, the next painted() completes it */
+  void dispatched(uint64_t event_usec, uint64_t now);
+  void painted(uint64_t now);
+
+  const LatencyHistogram& get_histogram(Stage stage) const { return m_histograms[stage]; }
+  void reset();
+
+  /** One line with p50/p99/max of every stage that saw events */
+  std::string str() const;
+
+private:
+  LatencyTracker(const LatencyTracker&) = delete;
+  LatencyTracker& operator=(const LatencyTracker&) = delete;
+};
+
+#endif
+
+/* EOF */
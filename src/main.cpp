@@ -15,7 +15,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <iostream>
+#include <string>
 #include <vector>
+#include <stdlib.h>
 #include <string.h>
 
 #include <QString>
@@ -31,8 +33,24 @@ void print_help()
             << "\n"
             << "   DEVICE  event device file to start with\n"
             << "\n"
-            << "   -v, --version   Print version number\n"
-            << "   -h, --help      Print help\n";
+            << "   --frame-rate HZ  Update the display at most HZ times per second\n"
+            << "                    (default: 60, 0: update on every event)\n"
+            << "   --multi          Test all devices at the same time, one tab per device\n"
+            << "   --match NAME     Only pick up devices whose name contains NAME\n"
+            << "   --record FILE    Record the events of the device to FILE\n"
+            << "   --replay FILE    Play back a recording instead of using a device\n"
+            << "   --speed FACTOR   Replay speed, 1: original timing (default),\n"
+            << "                    0: as fast as possible\n"
+            << "   --latency        Measure the latency from the kernel to the screen\n"
+            << "   --filter EXPR    Only display events matching EXPR, e.g.\n"
+            << "                    'type==EV_ABS && code in {ABS_X,ABS_Y} && |value|>100'\n"
+            << "   --kernel-mask    Have the kernel drop what the --filter rejects\n"
+            << "   --synthetic PROFILE[:HZ]\n"
+            << "                    Test a generated gamepad, mouse or keyboard reporting\n"
+            << "                    at HZ (default: 1000), can be given multiple times,\n"
+            << "                    which implies --multi\n"
+            << "   -v, --version    Print version number\n"
+            << "   -h, --help       Print help\n";
 }
 
 #ifndef EVTEST_QT_VERSION
@@ -48,6 +66,16 @@ int main(int argc, char** argv)
   app.setWindowIcon(QIcon::fromTheme("evtest-qt"));
 
   std::vector<QString> args;
+  int frame_rate = 60;
+  bool multi = false;
+  std::string match;
+  std::string record_filename;
+  std::string replay_filename;
+  double replay_speed = 1.0;
+  std::vector<std::string> synthetic_specs;
+  bool latency = false;
+  std::string filter;
+  bool kernel_mask = false;
 
   for(int i = 1; i < argc; ++i)
   {
@@ -63,6 +91,109 @@ int main(int argc, char** argv)
       std::cout << "evtest-qt " << EVTEST_QT_VERSION << std::endl;
       return 0;
     }
+    else if (strcmp(argv[i], "--frame-rate") == 0)
+    {
+      ++i;
+      if (i >= argc)
+      {
+        std::cerr << argv[i-1] << " requires an argument" << std::endl;
+        return 1;
+      }
+      else
+      {
+        frame_rate = atoi(argv[i]);
+      }
+    }
+    else if (strcmp(argv[i], "--multi") == 0)
+    {
+      multi = true;
+    }
+    else if (strcmp(argv[i], "--match") == 0)
+    {
+      ++i;
+      if (i >= argc)
+      {
+        std::cerr << argv[i-1] << " requires an argument" << std::endl;
+        return 1;
+      }
+      else
+      {
+        match = argv[i];
+      }
+    }
+    else if (strcmp(argv[i], "--record") == 0)
+    {
+      ++i;
+      if (i >= argc)
+      {
+        std::cerr << argv[i-1] << " requires an argument" << std::endl;
+        return 1;
+      }
+      else
+      {
+        record_filename = argv[i];
+      }
+    }
+    else if (strcmp(argv[i], "--replay") == 0)
+    {
+      ++i;
+      if (i >= argc)
+      {
+        std::cerr << argv[i-1] << " requires an argument" << std::endl;
+        return 1;
+      }
+      else
+      {
+        replay_filename = argv[i];
+      }
+    }
+    else if (strcmp(argv[i], "--speed") == 0)
+    {
+      ++i;
+      if (i >= argc)
+      {
+        std::cerr << argv[i-1] << " requires an argument" << std::endl;
+        return 1;
+      }
+      else
+      {
+        replay_speed = atof(argv[i]);
+      }
+    }
+    else if (strcmp(argv[i], "--latency") == 0)
+    {
+      latency = true;
+    }
+    else if (strcmp(argv[i], "--filter") == 0)
+    {
+      ++i;
+      if (i >= argc)
+      {
+        std::cerr << argv[i-1] << " requires an argument" << std::endl;
+        return 1;
+      }
+      else
+      {
+        filter = argv[i];
+      }
+    }
+    else if (strcmp(argv[i], "--kernel-mask") == 0)
+    {
+      kernel_mask = true;
+    }
+    else if (strcmp(argv[i], "--synthetic") == 0)
+    {
+      ++i;
+      if (i >= argc)
+      {
+        std::cerr << argv[i-1] << " requires an argument" << std::endl;
+        return 1;
+      }
+      else
+      {
+        synthetic_specs.push_back(argv[i]);
+      }
+    }
     else
     {
       if (!args.empty())
@@ -77,10 +208,42 @@ int main(int argc, char** argv)
     }
   }
 
+  // a single device view only has room for one of them
+  if (synthetic_specs.size() > 1)
+  {
+    multi = true;
+  }
+
   EvtestApp evtest;
+  evtest.set_frame_rate(frame_rate);
+  evtest.set_multi_device(multi);
+  evtest.set_match(match);
+  evtest.set_record_filename(record_filename);
+  evtest.set_latency_enabled(latency);
+  evtest.set_kernel_mask(kernel_mask);
+  try
+  {
+    evtest.set_filter(filter);
+  }
+  catch(const std::exception& err)
+  {
+    std::cerr << "error: " << err.what() << std::endl;
+    return 1;
+  }
   evtest.refresh_device_list();
 
-  if (!args.empty())
+  if (!synthetic_specs.empty())
+  {
+    for(const auto& spec : synthetic_specs)
+    {
+      evtest.open_synthetic(spec);
+    }
+  }
+  else if (!replay_filename.empty())
+  {
+    evtest.open_replay(replay_filename, replay_speed);
+  }
+  else if (!args.empty())
   {
     evtest.select_device(args[0]);
   }
@@ -0,0 +1,83 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_MEMORY_USAGE_HPP
+#define HEADER_MEMORY_USAGE_HPP
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/** Heap bytes and the number of heap blocks held by an object,
+    counted from the capacities of its containers */
+class MemoryUsage
+{
+public:
+  size_t bytes;
+  size_t allocations;
+
+  MemoryUsage() :
+    bytes(0),
+    allocations(0)
+  {}
+
+  /** An object that got allocated on its own, e.g. by make_unique */
+  void add_object(size_t size)
+  {
+    bytes += size;
+    allocations += 1;
+  }
+
+  template<typename T>
+  void add(const std::vector<T>& vec)
+  {
+    if (vec.capacity() != 0)
+    {
+      add_object(vec.capacity() * sizeof(T));
+    }
+  }
+
+  void add(const std::vector<bool>& vec)
+  {
+    if (vec.capacity() != 0)
+    {
+      add_object((vec.capacity() + 7) / 8);
+    }
+  }
+
+  void add(const std::string& str)
+  {
+    // short strings live inside the string object itself
+    const char* data = str.data();
+    const char* self = reinterpret_cast<const char*>(&str);
+    if (data < self || data >= self + sizeof(str))
+    {
+      add_object(str.capacity() + 1);
+    }
+  }
+
+  MemoryUsage& operator+=(const MemoryUsage& rhs)
+  {
+    bytes += rhs.bytes;
+    allocations += rhs.allocations;
+    return *this;
+  }
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,123 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "multitouch_slots.hpp"
+
+#include <algorithm>
+
+#include "evdev_info.hpp"
+#include "evdev_snapshot.hpp"
+
+const uint16_t MultitouchSlots::first_code;
+const uint16_t MultitouchSlots::last_code;
+const size_t MultitouchSlots::max_axes;
+const uint8_t MultitouchSlots::no_column;
+
+MultitouchSlots::MultitouchSlots() :
+  m_num_slots(0),
+  m_codes(),
+  m_columns(),
+  m_values(),
+  m_dirty_axes(),
+  m_dirty_slots()
+{
+  m_columns.fill(no_column);
+}
+
+MultitouchSlots::MultitouchSlots(const EvdevInfo& info) :
+  m_num_slots(0),
+  m_codes(),
+  m_columns(),
+  m_values(),
+  m_dirty_axes(),
+  m_dirty_slots()
+{
+  m_columns.fill(no_column);
+
+  if (!info.has_abs(ABS_MT_SLOT))
+  {
+    return;
+  }
+
+  const AbsInfo& absinfo = info.get_absinfo(ABS_MT_SLOT);
+  m_num_slots = EvdevSnapshot::get_num_mt_slots(absinfo.maximum);
+
+  for(uint16_t code = first_code; code <= last_code; ++code)
+  {
+    if (info.has_abs(code))
+    {
+      m_columns[code - first_code] = static_cast<uint8_t>(m_codes.size());
+      m_codes.push_back(code);
+    }
+  }
+
+  m_values.resize(m_codes.size() * m_num_slots, 0);
+  if (has(ABS_MT_TRACKING_ID))
+  {
+    // no contact in any slot until the device says otherwise
+    std::fill_n(m_values.begin() + m_columns[ABS_MT_TRACKING_ID - first_code] * m_num_slots,
+                m_num_slots, -1);
+  }
+
+  m_dirty_axes.resize(m_num_slots, 0);
+  m_dirty_slots = DirtySet(m_num_slots);
+}
+
+void
+MultitouchSlots::set_snapshot(const EvdevSnapshot& snapshot)
+{
+  for(size_t column = 0; column < m_codes.size(); ++column)
+  {
+    const std::vector<int32_t>& values = snapshot.mt_values[m_codes[column] - first_code];
+    const size_t count = std::min(m_num_slots, values.size());
+    const auto begin = m_values.begin() + static_cast<ptrdiff_t>(column * m_num_slots);
+
+    std::copy_n(values.begin(), count, begin);
+    std::fill(begin + static_cast<ptrdiff_t>(count), begin + static_cast<ptrdiff_t>(m_num_slots),
+              m_codes[column] == ABS_MT_TRACKING_ID ? -1 : 0);
+  }
+
+  const uint16_t all_columns = static_cast<uint16_t>((1u << m_codes.size()) - 1);
+  for(size_t slot = 0; slot < m_num_slots; ++slot)
+  {
+    m_dirty_axes[slot] = all_columns;
+    m_dirty_slots.mark(slot);
+  }
+}
+
+void
+MultitouchSlots::clear_dirty()
+{
+  for(auto slot : m_dirty_slots.items())
+  {
+    m_dirty_axes[slot] = 0;
+  }
+  m_dirty_slots.clear();
+}
+
+MemoryUsage
+MultitouchSlots::get_memory_usage() const
+{
+  MemoryUsage usage;
+  usage.add(m_codes);
+  usage.add(m_values);
+  usage.add(m_dirty_axes);
+  usage += m_dirty_slots.get_memory_usage();
+  return usage;
+}
+
+/* EOF */
@@ -0,0 +1,130 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_MULTITOUCH_SLOTS_HPP
+#define HEADER_MULTITOUCH_SLOTS_HPP
+
+#include <array>
+#include <linux/input.h>
+#include <stdint.h>
+#include <vector>
+
+#include "dirty_set.hpp"
+#include "memory_usage.hpp"
+
+class EvdevInfo;
+class EvdevSnapshot;
+
+/** The slots of a multitouch protocol B device with every ABS_MT_*
+    axis the device has. The values are stored one column per axis,
+    so an axis is contiguous over all slots and can be read without
+    copying. Each slot has a mask of the axes that changed since the
+    last clear_dirty(). */
+class MultitouchSlots
+{
+public:
+  // the per slot axes, ABS_MT_SLOT itself selects the slot
+  static const uint16_t first_code = ABS_MT_TOUCH_MAJOR;
+  static const uint16_t last_code = ABS_MT_TOOL_Y;
+  static const size_t max_axes = last_code - first_code + 1;
+
+private:
+  static const uint8_t no_column = 0xff;
+
+  size_t m_num_slots;
+  // the codes of the columns
+  std::vector<uint16_t> m_codes;
+  // code - first_code -> column, no_column when the device doesn't
+  // have the axis
+  std::array<uint8_t, max_axes> m_columns;
+  // m_codes.size() columns of m_num_slots values
+  std::vector<int32_t> m_values;
+
+  // per slot, bit n marks column n as changed
+  std::vector<uint16_t> m_dirty_axes;
+  DirtySet m_dirty_slots;
+
+public:
+  MultitouchSlots();
+
+  /** Slots and axes as \a info advertises them, a device without
+      ABS_MT_SLOT has no slots */
+  MultitouchSlots(const EvdevInfo& info);
+
+  size_t size() const { return m_num_slots; }
+
+  /** The ABS_MT_* axes of the device */
+  const std::vector<uint16_t>& get_codes() const { return m_codes; }
+
+  bool has(uint16_t code) const { return get_column_idx(code) != no_column; }
+
+  /** The value of \a code in \a slot, 0 for axes the device doesn't
+      have */
+  int32_t get(size_t slot, uint16_t code) const
+  {
+    const uint8_t column = get_column_idx(code);
+    return column != no_column ? m_values[column * m_num_slots + slot] : 0;
+  }
+
+  /** The values of \a code for all slots, nullptr for axes the
+      device doesn't have */
+  const int32_t* get_column(uint16_t code) const
+  {
+    const uint8_t column = get_column_idx(code);
+    return column != no_column ? &m_values[column * m_num_slots] : nullptr;
+  }
+
+  /** Store \a value for \a code in \a slot, codes that aren't per
+      slot axes of the device are ignored */
+  void set(size_t slot, uint16_t code, int32_t value)
+  {
+    const uint8_t column = get_column_idx(code);
+    if (column != no_column)
+    {
+      m_values[column * m_num_slots + slot] = value;
+      m_dirty_axes[slot] = static_cast<uint16_t>(m_dirty_axes[slot] | (1u << column));
+      m_dirty_slots.mark(slot);
+    }
+  }
+
+  /** Replace all slots with the EVIOCGMTSLOTS values of \a snapshot,
+      slots it has no values for are reset to no contact */
+  void set_snapshot(const EvdevSnapshot& snapshot);
+
+  /** The slots that changed since the last clear_dirty() */
+  const DirtySet& get_dirty_slots() const { return m_dirty_slots; }
+
+  bool is_dirty(size_t slot, uint16_t code) const
+  {
+    const uint8_t column = get_column_idx(code);
+    return column != no_column && (m_dirty_axes[slot] & (1u << column)) != 0;
+  }
+
+  void clear_dirty();
+
+  MemoryUsage get_memory_usage() const;
+
+private:
+  uint8_t get_column_idx(uint16_t code) const
+  {
+    return (code >= first_code && code <= last_code) ? m_columns[code - first_code] : no_column;
+  }
+};
+
+#endif
+
+/* EOF */
@@ -21,11 +21,13 @@
 
 #include "evdev_state.hpp"
 
-MultitouchWidget::MultitouchWidget(QWidget* parent_) :
+MultitouchWidget::MultitouchWidget(const EvdevState& state, QWidget* parent_) :
   QWidget(parent_),
-  m_max_x(),
-  m_max_y(),
-  m_mt_states()
+  m_state(state),
+  m_max_x(state.get_info().has_abs(ABS_MT_POSITION_X) ?
+          state.get_info().get_absinfo(ABS_MT_POSITION_X).maximum : 0),
+  m_max_y(state.get_info().has_abs(ABS_MT_POSITION_Y) ?
+          state.get_info().get_absinfo(ABS_MT_POSITION_Y).maximum : 0)
 {
 }
 
@@ -36,17 +38,18 @@ MultitouchWidget::~MultitouchWidget()
 void
 MultitouchWidget::on_change(const EvdevState& state)
 {
-  m_max_x = state.get_info().get_absinfo(ABS_MT_POSITION_X).maximum;
-  m_max_y = state.get_info().get_absinfo(ABS_MT_POSITION_Y).maximum;
-
-  m_mt_states.resize(static_cast<size_t>(state.get_mt_slot_count()));
-
-  for(int slot = 0; slot < state.get_mt_slot_count(); ++slot)
+  // only the positions and contacts are painted
+  const MultitouchSlots& mt_slots = state.get_mt_slots();
+  for(auto slot : mt_slots.get_dirty_slots().items())
   {
-    m_mt_states[static_cast<size_t>(slot)] = state.get_mt_state(slot);
+    if (mt_slots.is_dirty(slot, ABS_MT_POSITION_X) ||
+        mt_slots.is_dirty(slot, ABS_MT_POSITION_Y) ||
+        mt_slots.is_dirty(slot, ABS_MT_TRACKING_ID))
+    {
+      update();
+      break;
+    }
   }
-
-  update();
 }
 
 void
@@ -55,12 +58,22 @@ MultitouchWidget::paintEvent(QPaintEvent* ev)
   QPainter painter(this);
   painter.setRenderHint(QPainter::Antialiasing);
 
+  const MultitouchSlots& mt_slots = m_state.get_mt_slots();
+  const int32_t* xs = mt_slots.get_column(ABS_MT_POSITION_X);
+  const int32_t* ys = mt_slots.get_column(ABS_MT_POSITION_Y);
+  const int32_t* tracking_ids = mt_slots.get_column(ABS_MT_TRACKING_ID);
+  if (!xs || !ys || !tracking_ids || m_max_x == 0 || m_max_y == 0)
+  {
+    painter.drawRect(0, 0, width(), height());
+    return;
+  }
+
   int b = 3;
-  for(size_t slot = 0; slot < m_mt_states.size(); ++slot)
+  for(size_t slot = 0; slot < mt_slots.size(); ++slot)
   {
-    int x_pos = m_mt_states[slot].x * width() / m_max_x;
-    int y_pos = m_mt_states[slot].y * height() / m_max_y;
-    if (m_mt_states[slot].tracking_id == -1)
+    int x_pos = xs[slot] * width() / m_max_x;
+    int y_pos = ys[slot] * height() / m_max_y;
+    if (tracking_ids[slot] == -1)
     {
       painter.setPen(QColor(255, 0, 0));
       painter.drawRect(x_pos - b, y_pos - b, 2*b, 2*b);
@@ -72,7 +85,7 @@ MultitouchWidget::paintEvent(QPaintEvent* ev)
     painter.setPen(QColor(0, 0, 0));
     // fudging with b to create a larger clipping rectangle
     painter.drawText(x_pos - 10*b, y_pos - 8*b, 20*b, 16*b, Qt::AlignHCenter  | Qt::AlignBottom,
-                     QString::number(m_mt_states[slot].tracking_id));
+                     QString::number(tracking_ids[slot]));
   }
   painter.drawRect(0, 0, width(), height());
 }
@@ -26,12 +26,14 @@ class MultitouchWidget : public QWidget
   Q_OBJECT
 
 private:
+  // the slots are painted straight from the state, nothing gets
+  // copied per frame
+  const EvdevState& m_state;
   int m_max_x;
   int m_max_y;
-  std::vector<MultitouchState> m_mt_states;
 
 public:
-  MultitouchWidget(QWidget* parent_=0);
+  MultitouchWidget(const EvdevState& state, QWidget* parent_=0);
   virtual ~MultitouchWidget();
 
   QSize sizeHint() const  override { return QSize(400, 225); };
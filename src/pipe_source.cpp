@@ -0,0 +1,135 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "pipe_source.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string.h>
+#include <unistd.h>
+
+PipeSource::PipeSource(const std::string& filename, const EvdevInfo& info) :
+  m_filename(filename),
+  m_info(info),
+  m_read_fd(-1),
+  m_write_fd(-1),
+  m_partial(),
+  m_partial_size(0),
+  m_snapshot(),
+  m_has_snapshot(false)
+{
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) < 0)
+  {
+    throw std::runtime_error(std::string("pipe2: ") + strerror(errno));
+  }
+  m_read_fd = fds[0];
+  m_write_fd = fds[1];
+
+  // only the reading end is non-blocking, like a device node
+  fcntl(m_read_fd, F_SETFL, fcntl(m_read_fd, F_GETFL) | O_NONBLOCK);
+}
+
+PipeSource::~PipeSource()
+{
+  close(m_read_fd);
+  close_write();
+}
+
+ssize_t
+PipeSource::read_events(struct input_event* ev, size_t count)
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  uint8_t* out = reinterpret_cast<uint8_t*>(ev);
+  memcpy(out, m_partial, m_partial_size);
+
+  ssize_t rd = ::read(m_read_fd, out + m_partial_size,
+                      sizeof(struct input_event) * count - m_partial_size);
+  if (rd < 0)
+  {
+    return errno == EAGAIN ? 0 : -1;
+  }
+  else if (rd == 0)
+  {
+    // the writing end is closed, fail like a read from an unplugged
+    // device, a partial event left over is lost with it
+    m_partial_size = 0;
+    return -1;
+  }
+
+  // a pipe doesn't keep the events in one piece, carry the tail of
+  // a split event over to the next read
+  const size_t total = m_partial_size + static_cast<size_t>(rd);
+  const size_t num_events = total / sizeof(struct input_event);
+  m_partial_size = total % sizeof(struct input_event);
+  memcpy(m_partial, out + num_events * sizeof(struct input_event), m_partial_size);
+
+  return static_cast<ssize_t>(num_events);
+}
+
+void
+PipeSource::write_events(const struct input_event* ev, size_t count)
+{
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(ev);
+  size_t len = sizeof(struct input_event) * count;
+  while(len > 0)
+  {
+    ssize_t wr = ::write(m_write_fd, data, len);
+    if (wr < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      throw std::runtime_error(m_filename + ": " + strerror(errno));
+    }
+    data += wr;
+    len -= static_cast<size_t>(wr);
+  }
+}
+
+bool
+PipeSource::read_snapshot(EvdevSnapshot& snapshot)
+{
+  if (m_has_snapshot)
+  {
+    snapshot = m_snapshot;
+  }
+  return m_has_snapshot;
+}
+
+void
+PipeSource::set_snapshot(const EvdevSnapshot& snapshot)
+{
+  m_snapshot = snapshot;
+  m_has_snapshot = true;
+}
+
+void
+PipeSource::close_write()
+{
+  if (m_write_fd >= 0)
+  {
+    close(m_write_fd);
+    m_write_fd = -1;
+  }
+}
+
+/* EOF */
@@ -0,0 +1,70 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HEADER_PIPE_SOURCE_HPP
+#define HEADER_PIPE_SOURCE_HPP
+
+#include <stdint.h>
+
+#include "event_source.hpp"
+
+/** A fake device whose events are written into a pipe, either with
+    write_events() or by anything that gets hold of get_write_fd(),
+    e.g. a test or another process. The capabilities are the ones
+    passed to the constructor. */
+class PipeSource : public EventSource
+{
+private:
+  std::string m_filename;
+  EvdevInfo m_info;
+  int m_read_fd;
+  int m_write_fd;
+
+  // a partial event left over from the last read
+  uint8_t m_partial[sizeof(struct input_event)];
+  size_t m_partial_size;
+
+  EvdevSnapshot m_snapshot;
+  bool m_has_snapshot;
+
+public:
+  PipeSource(const std::string& filename, const EvdevInfo& info);
+  ~PipeSource() override;
+
+  EvdevInfo read_evdev_info() override { return m_info; }
+  ssize_t read_events(struct input_event* ev, size_t count) override;
+  int get_fd() const override { return m_read_fd; }
+  const std::string& get_filename() const override { return m_filename; }
+
+  /** Returns the snapshot given to set_snapshot(), false before */
+  bool read_snapshot(EvdevSnapshot& snapshot) override;
+
+  /** The device state read_snapshot() reports from now on, e.g. what
+      a device ended up with after events got lost */
+  void set_snapshot(const EvdevSnapshot& snapshot);
+
+  /** Blocking, writes all \a count events or throws */
+  void write_events(const struct input_event* ev, size_t count);
+  int get_write_fd() const { return m_write_fd; }
+
+  /** Close the writing end, the reader sees EPOLLHUP and, once the
+      pipe is drained, read_events() fails like it would for an
+      unplugged device */
+  void close_write();
+};
+
+#endif
+
+/* EOF */
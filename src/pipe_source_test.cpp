@@ -0,0 +1,156 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <iostream>
+#include <memory>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "evdev_state.hpp"
+#include "pipe_source.hpp"
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    g_failures += 1;
+  }
+}
+
+EvdevInfo make_gamepad_info()
+{
+  std::array<unsigned long, bits::nbits(EV_MAX)> bit{};
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit{};
+  std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit{};
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit{};
+  std::array<AbsInfo, ABS_CNT> absinfos;
+
+  bit[bits::long_idx(EV_KEY)] |= bits::bit(EV_KEY);
+  bit[bits::long_idx(EV_ABS)] |= bits::bit(EV_ABS);
+  key_bit[bits::long_idx(BTN_SOUTH)] |= bits::bit(BTN_SOUTH);
+  abs_bit[bits::long_idx(ABS_X)] |= bits::bit(ABS_X);
+
+  // a range that excludes 0, the state has to start from the value
+  input_absinfo absinfo{};
+  absinfo.minimum = 10;
+  absinfo.maximum = 255;
+  absinfo.value = 128;
+  absinfos[ABS_X] = AbsInfo(absinfo);
+
+  input_id id{};
+  return EvdevInfo(0, "pipe gamepad", "pipe/input0", id,
+                   bit, abs_bit, rel_bit, key_bit, absinfos);
+}
+
+struct input_event make_event(uint16_t type, uint16_t code, int32_t value)
+{
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  return ev;
+}
+
+/** Feed everything \a source has to \a state, returns the number of
+    events or -1 when the source failed */
+ssize_t pump(PipeSource& source, EvdevState& state)
+{
+  struct input_event ev[4];
+  ssize_t total = 0;
+  ssize_t num_events;
+  while((num_events = source.read_events(ev, 4)) > 0)
+  {
+    for(ssize_t i = 0; i < num_events; ++i)
+    {
+      state.update(ev[i]);
+    }
+    total += num_events;
+  }
+  return num_events < 0 ? -1 : total;
+}
+
+void write_raw(PipeSource& source, const void* data, size_t len)
+{
+  check(write(source.get_write_fd(), data, len) == static_cast<ssize_t>(len), "write to pipe");
+}
+
+} // namespace
+
+int main()
+{
+  PipeSource source("pipe-test", make_gamepad_info());
+  EvdevState state(std::make_shared<EvdevInfo>(source.read_evdev_info()));
+  // deliver every frame right away, there is no event loop
+  state.set_frame_rate(0);
+
+  check(state.get_abs_value(ABS_X) == 128, "seeded from the absinfo");
+  check(state.get_abs_min(ABS_X) > state.get_abs_max(ABS_X), "no extremes before the first event");
+  check(pump(source, state) == 0, "empty pipe");
+
+  // whole frames
+  const struct input_event frame[] = {
+    make_event(EV_KEY, BTN_SOUTH, 1),
+    make_event(EV_ABS, ABS_X, 200),
+    make_event(EV_SYN, SYN_REPORT, 0),
+    make_event(EV_ABS, ABS_X, 20),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  source.write_events(frame, 5);
+  check(pump(source, state) == 5, "frames read");
+  check(state.get_key_value(BTN_SOUTH) == 1, "key pressed");
+  check(state.get_abs_value(ABS_X) == 20, "axis moved");
+
+  // an event split across two writes only shows up once it is complete
+  const struct input_event split[] = {
+    make_event(EV_KEY, BTN_SOUTH, 0),
+    make_event(EV_SYN, SYN_REPORT, 0)
+  };
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(split);
+  const size_t half = sizeof(struct input_event) / 2;
+  write_raw(source, data, half);
+  check(pump(source, state) == 0, "partial event held back");
+  check(state.get_key_value(BTN_SOUTH) == 1, "partial event not applied");
+  write_raw(source, data + half, sizeof(split) - half);
+  check(pump(source, state) == 2, "partial event completed");
+  check(state.get_key_value(BTN_SOUTH) == 0, "key released");
+
+  // a closed pipe is an unplugged device, a trailing partial event
+  // is dropped
+  write_raw(source, data, half);
+  source.close_write();
+  check(pump(source, state) == 0, "trailing partial event held back");
+  check(pump(source, state) == -1, "EOF reported as failure");
+  check(state.get_key_value(BTN_SOUTH) == 0, "state kept after EOF");
+  check(state.get_abs_value(ABS_X) == 20, "axis kept after EOF");
+
+  if (g_failures)
+  {
+    std::cerr << g_failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "all checks passed" << std::endl;
+  return 0;
+}
+
+/* EOF */
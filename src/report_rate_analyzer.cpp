@@ -0,0 +1,139 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "report_rate_analyzer.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// intervals needed before the mean is trusted for gap detection
+const uint64_t kWarmup = 8;
+
+const int kNominalRates[] = { 60, 125, 250, 500, 1000, 2000, 4000, 8000 };
+
+} // namespace
+
+int
+ReportRateAnalyzer::nominal_rate(double hz)
+{
+  int best = kNominalRates[0];
+  for(int rate : kNominalRates)
+  {
+    // compare on a log scale, 750 Hz is as far from 500 as from 1000
+    if (std::fabs(std::log(hz / rate)) < std::fabs(std::log(hz / best)))
+    {
+      best = rate;
+    }
+  }
+  return best;
+}
+
+ReportRateAnalyzer::ReportRateAnalyzer() :
+  m_intervals(),
+  m_last_usec(0),
+  m_count(0),
+  m_mean(0.0),
+  m_m2(0.0),
+  m_min(0),
+  m_max(0),
+  m_gaps(0),
+  m_idle(0)
+{
+}
+
+void
+ReportRateAnalyzer::add_report(uint64_t usec)
+{
+  const uint64_t last_usec = m_last_usec;
+  m_last_usec = usec;
+  if (last_usec == 0)
+  {
+    return;
+  }
+
+  const uint64_t interval = usec > last_usec ? usec - last_usec : 0;
+  if (interval >= kIdleUsec)
+  {
+    ++m_idle;
+    return;
+  }
+
+  if (m_count >= kWarmup && static_cast<double>(interval) > 1.5 * m_mean)
+  {
+    ++m_gaps;
+  }
+
+  m_intervals.record(interval);
+
+  m_count += 1;
+  const double delta = static_cast<double>(interval) - m_mean;
+  m_mean += delta / static_cast<double>(m_count);
+  m_m2 += delta * (static_cast<double>(interval) - m_mean);
+
+  if (m_count == 1 || interval < m_min)
+  {
+    m_min = interval;
+  }
+  if (interval > m_max)
+  {
+    m_max = interval;
+  }
+}
+
+void
+ReportRateAnalyzer::reset()
+{
+  m_intervals.reset();
+  m_last_usec = 0;
+  m_count = 0;
+  m_mean = 0.0;
+  m_m2 = 0.0;
+  m_min = 0;
+  m_max = 0;
+  m_gaps = 0;
+  m_idle = 0;
+}
+
+double
+ReportRateAnalyzer::get_jitter() const
+{
+  return m_count > 1 ? std::sqrt(m_m2 / static_cast<double>(m_count - 1)) : 0.0;
+}
+
+std::string
+ReportRateAnalyzer::str() const
+{
+  if (m_count == 0)
+  {
+    return std::string();
+  }
+
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1)
+      << get_rate() << " Hz (nominal " << nominal_rate(get_rate()) << " Hz)"
+      << std::setprecision(3)
+      << "  interval p50 " << static_cast<double>(m_intervals.get_percentile(50.0)) / 1000.0 << "ms"
+      << " p99 " << static_cast<double>(m_intervals.get_percentile(99.0)) / 1000.0 << "ms"
+      << " min " << static_cast<double>(m_min) / 1000.0 << "ms"
+      << " max " << static_cast<double>(m_max) / 1000.0 << "ms"
+      << "  jitter " << get_jitter() / 1000.0 << "ms"
+      << "  gaps " << m_gaps;
+  return out.str();
+}
+
+/* EOF */
@@ -0,0 +1,83 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HEADER_REPORT_RATE_ANALYZER_HPP
+#define HEADER_REPORT_RATE_ANALYZER_HPP
+
+#include <stdint.h>
+#include <string>
+
+#include "latency_histogram.hpp"
+
+/** Derives the report rate and jitter of a device from the
+    timestamps of its SYN_REPORT events, in constant memory and
+    constant time per report. Pauses longer than kIdleUsec, e.g. a
+    mouse that isn't moved, count as idle and stay out of the
+    statistics, intervals more than 1.5 times the average count as
+    gaps, i.e. dropped reports. */
+class ReportRateAnalyzer
+{
+public:
+  static const uint64_t kIdleUsec = 100000;
+
+  /** The standard USB polling rate closest to \a hz */
+  static int nominal_rate(double hz);
+
+private:
+  LatencyHistogram m_intervals;
+  uint64_t m_last_usec;
+
+  // running mean and sum of squared differences (Welford)
+  uint64_t m_count;
+  double m_mean;
+  double m_m2;
+
+  uint64_t m_min;
+  uint64_t m_max;
+  uint64_t m_gaps;
+  uint64_t m_idle;
+
+public:
+  ReportRateAnalyzer();
+
+  void add_report(uint64_t usec);
+  void reset();
+
+  /** Number of intervals that went into the statistics */
+  uint64_t get_count() const { return m_count; }
+
+  double get_rate() const { return m_mean > 0.0 ? 1000000.0 / m_mean : 0.0; }
+  double get_mean_interval() const { return m_mean; }
+
+  /** Standard deviation of the report interval in microseconds */
+  double get_jitter() const;
+
+  uint64_t get_min_interval() const { return m_min; }
+  uint64_t get_max_interval() const { return m_max; }
+  uint64_t get_gaps() const { return m_gaps; }
+  uint64_t get_idle_periods() const { return m_idle; }
+  const LatencyHistogram& get_intervals() const { return m_intervals; }
+
+  /** One line summary, empty while there are no intervals yet */
+  std::string str() const;
+
+private:
+  ReportRateAnalyzer(const ReportRateAnalyzer&) = delete;
+  ReportRateAnalyzer& operator=(const ReportRateAnalyzer&) = delete;
+};
+
+#endif
+
+/* EOF */
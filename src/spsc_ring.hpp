@@ -0,0 +1,133 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SPSC_RING_HPP
+#define HEADER_SPSC_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/** A fixed-size lock-free ring buffer for exactly one producer and
+    one consumer thread. When the ring is full push() drops what
+    doesn't fit and counts it as overflow. */
+template<typename T>
+class SpscRing
+{
+private:
+  std::vector<T> m_buffer;
+  size_t m_mask;
+
+  // head is only written by the producer, tail only by the consumer,
+  // the padding keeps them on different cache lines
+  std::atomic<size_t> m_head;
+  char m_pad0[64];
+  std::atomic<size_t> m_tail;
+  char m_pad1[64];
+
+  std::atomic<size_t> m_high_water_mark;
+  std::atomic<uint64_t> m_overflows;
+
+  static size_t round_up_pow2(size_t v)
+  {
+    size_t n = 1;
+    while(n < v)
+    {
+      n <<= 1;
+    }
+    return n;
+  }
+
+public:
+  /** \a capacity gets rounded up to the next power of two */
+  SpscRing(size_t capacity) :
+    m_buffer(round_up_pow2(capacity)),
+    m_mask(m_buffer.size() - 1),
+    m_head(0),
+    m_pad0(),
+    m_tail(0),
+    m_pad1(),
+    m_high_water_mark(0),
+    m_overflows(0)
+  {
+  }
+
+  /** Producer side, returns the number of items that were stored */
+  size_t push(const T* items, size_t count)
+  {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    const size_t tail = m_tail.load(std::memory_order_acquire);
+    const size_t n = std::min(count, m_buffer.size() - (head - tail));
+
+    for(size_t i = 0; i < n; ++i)
+    {
+      m_buffer[(head + i) & m_mask] = items[i];
+    }
+    m_head.store(head + n, std::memory_order_release);
+
+    const size_t fill = head + n - tail;
+    if (fill > m_high_water_mark.load(std::memory_order_relaxed))
+    {
+      m_high_water_mark.store(fill, std::memory_order_relaxed);
+    }
+
+    if (n < count)
+    {
+      m_overflows.fetch_add(count - n, std::memory_order_relaxed);
+    }
+
+    return n;
+  }
+
+  /** Consumer side, returns the number of items that were fetched */
+  size_t pop(T* items, size_t max_count)
+  {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    const size_t head = m_head.load(std::memory_order_acquire);
+    const size_t n = std::min(max_count, head - tail);
+
+    for(size_t i = 0; i < n; ++i)
+    {
+      items[i] = m_buffer[(tail + i) & m_mask];
+    }
+    m_tail.store(tail + n, std::memory_order_release);
+
+    return n;
+  }
+
+  bool empty() const
+  {
+    return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const { return m_buffer.size(); }
+
+  /** The highest number of items that were queued at once */
+  size_t get_high_water_mark() const { return m_high_water_mark.load(std::memory_order_relaxed); }
+
+  /** The number of items dropped because the ring was full */
+  uint64_t get_overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+
+private:
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+};
+
+#endif
+
+/* EOF */
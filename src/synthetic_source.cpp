@@ -0,0 +1,284 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "synthetic_source.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "event_time.hpp"
+
+namespace {
+
+// upper bound for the frames generated after a stall, so a reader
+// that fell behind catches up instead of getting buried
+const uint64_t kMaxFramesPerRead = 1024;
+
+const int kGamepadButtons[] = {
+  BTN_SOUTH, BTN_EAST, BTN_NORTH, BTN_WEST,
+  BTN_TL, BTN_TR, BTN_SELECT, BTN_START, BTN_MODE,
+  BTN_THUMBL, BTN_THUMBR
+};
+
+/** The report interval for \a rate reports per second, throws when
+    \a rate isn't in [1, 1000000] */
+uint64_t rate_to_interval_usec(int rate)
+{
+  if (rate <= 0 || rate > 1000000)
+  {
+    throw std::runtime_error("SyntheticSource: rate must be between 1 and 1000000 Hz");
+  }
+  return 1000000u / static_cast<unsigned>(rate);
+}
+
+void set_bit(unsigned long* bitmap, size_t code)
+{
+  bitmap[bits::long_idx(code)] |= bits::bit(code);
+}
+
+void push_event(std::vector<struct input_event>& events, uint64_t usec,
+                uint16_t type, uint16_t code, int32_t value)
+{
+  struct input_event ev;
+  set_event_usec(ev, usec);
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  events.push_back(ev);
+}
+
+} // namespace
+
+SyntheticSource::Profile
+SyntheticSource::parse_profile(const std::string& name)
+{
+  if (name == "gamepad")
+  {
+    return kGamepad;
+  }
+  else if (name == "mouse")
+  {
+    return kMouse;
+  }
+  else if (name == "keyboard")
+  {
+    return kKeyboard;
+  }
+  else
+  {
+    throw std::runtime_error("unknown synthetic device profile: " + name);
+  }
+}
+
+EvdevInfo
+SyntheticSource::make_info(Profile profile)
+{
+  std::array<unsigned long, bits::nbits(EV_MAX)> bit{};
+  std::array<unsigned long, bits::nbits(ABS_MAX)> abs_bit{};
+  std::array<unsigned long, bits::nbits(REL_MAX)> rel_bit{};
+  std::array<unsigned long, bits::nbits(KEY_MAX)> key_bit{};
+  std::array<AbsInfo, ABS_CNT> absinfos;
+  std::string name;
+
+  set_bit(bit.data(), EV_SYN);
+  set_bit(bit.data(), EV_KEY);
+
+  switch(profile)
+  {
+    case kGamepad:
+      name = "synthetic gamepad";
+      set_bit(bit.data(), EV_ABS);
+      for(uint16_t code : { uint16_t(ABS_X), uint16_t(ABS_Y), uint16_t(ABS_RX), uint16_t(ABS_RY) })
+      {
+        set_bit(abs_bit.data(), code);
+
+        input_absinfo absinfo{};
+        absinfo.minimum = -32768;
+        absinfo.maximum = 32767;
+        absinfos[code] = AbsInfo(absinfo);
+      }
+      for(int code : kGamepadButtons)
+      {
+        set_bit(key_bit.data(), static_cast<size_t>(code));
+      }
+      break;
+
+    case kMouse:
+      name = "synthetic mouse";
+      set_bit(bit.data(), EV_REL);
+      set_bit(rel_bit.data(), REL_X);
+      set_bit(rel_bit.data(), REL_Y);
+      set_bit(rel_bit.data(), REL_WHEEL);
+      set_bit(key_bit.data(), BTN_LEFT);
+      set_bit(key_bit.data(), BTN_RIGHT);
+      set_bit(key_bit.data(), BTN_MIDDLE);
+      break;
+
+    case kKeyboard:
+      name = "synthetic keyboard";
+      // every key report comes with its MSC_SCAN, like a real keyboard,
+      // EvdevInfo has no MSC code bits beyond the type
+      set_bit(bit.data(), EV_MSC);
+      for(size_t code = KEY_ESC; code <= KEY_KPDOT; ++code)
+      {
+        set_bit(key_bit.data(), code);
+      }
+      break;
+  }
+
+  input_id id{};
+  id.bustype = BUS_VIRTUAL;
+  return EvdevInfo(0x10001, name, "synthetic/input0", id,
+                   bit, abs_bit, rel_bit, key_bit, absinfos);
+}
+
+SyntheticSource::SyntheticSource(Profile profile, int rate) :
+  m_profile(profile),
+  m_filename(),
+  m_info(make_info(profile)),
+  m_timer_fd(-1),
+  m_interval_usec(rate_to_interval_usec(rate)),
+  m_frame(0),
+  m_pending(),
+  m_pending_pos(0)
+{
+  m_filename = "synthetic:" + m_info.name.substr(m_info.name.find(' ') + 1) +
+    ":" + std::to_string(rate);
+
+  m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (m_timer_fd < 0)
+  {
+    throw std::runtime_error(std::string("timerfd_create: ") + strerror(errno));
+  }
+
+  struct itimerspec spec;
+  spec.it_interval.tv_sec = 0;
+  spec.it_interval.tv_nsec = 1000000000L / rate;
+  if (spec.it_interval.tv_nsec == 0)
+  {
+    spec.it_interval.tv_sec = 1;
+  }
+  spec.it_value = spec.it_interval;
+  if (timerfd_settime(m_timer_fd, 0, &spec, nullptr) < 0)
+  {
+    int err = errno;
+    close(m_timer_fd);
+    throw std::runtime_error(std::string("timerfd_settime: ") + strerror(err));
+  }
+}
+
+SyntheticSource::~SyntheticSource()
+{
+  close(m_timer_fd);
+}
+
+ssize_t
+SyntheticSource::read_events(struct input_event* ev, size_t count)
+{
+  if (m_pending_pos == m_pending.size())
+  {
+    m_pending.clear();
+    m_pending_pos = 0;
+
+    uint64_t expirations = 0;
+    if (::read(m_timer_fd, &expirations, sizeof(expirations)) < 0)
+    {
+      return errno == EAGAIN ? 0 : -1;
+    }
+
+    // stamped with CLOCK_MONOTONIC like the EvdevDevice events
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const uint64_t usec = static_cast<uint64_t>(ts.tv_sec) * 1000000u + static_cast<uint64_t>(ts.tv_nsec) / 1000u;
+
+    // when the reader fell behind, space the frames out by the report
+    // interval as if they had been waiting in the kernel buffer
+    const uint64_t num_frames = std::min(expirations, kMaxFramesPerRead);
+    for(uint64_t i = 0; i < num_frames; ++i)
+    {
+      generate_frame(usec - (num_frames - 1 - i) * m_interval_usec);
+    }
+  }
+
+  const size_t n = std::min(count, m_pending.size() - m_pending_pos);
+  std::copy(m_pending.begin() + static_cast<ssize_t>(m_pending_pos),
+            m_pending.begin() + static_cast<ssize_t>(m_pending_pos + n),
+            ev);
+  m_pending_pos += n;
+  return static_cast<ssize_t>(n);
+}
+
+void
+SyntheticSource::generate_frame(uint64_t usec)
+{
+  const uint64_t frame = m_frame++;
+
+  switch(m_profile)
+  {
+    case kGamepad:
+      {
+        // both sticks circle through their whole range, one button
+        // gets pressed and released every 50 reports
+        const double angle = static_cast<double>(frame) * 0.01;
+        push_event(m_pending, usec, EV_ABS, ABS_X, static_cast<int32_t>(32767.0 * std::cos(angle)));
+        push_event(m_pending, usec, EV_ABS, ABS_Y, static_cast<int32_t>(32767.0 * std::sin(angle)));
+        push_event(m_pending, usec, EV_ABS, ABS_RX, static_cast<int32_t>(32767.0 * std::sin(angle * 0.7)));
+        push_event(m_pending, usec, EV_ABS, ABS_RY, static_cast<int32_t>(32767.0 * std::cos(angle * 0.7)));
+        if (frame % 25 == 0)
+        {
+          const size_t num_buttons = sizeof(kGamepadButtons) / sizeof(kGamepadButtons[0]);
+          const int button = kGamepadButtons[(frame / 50) % num_buttons];
+          push_event(m_pending, usec, EV_KEY, static_cast<uint16_t>(button), (frame / 25) % 2 == 0);
+        }
+      }
+      break;
+
+    case kMouse:
+      {
+        const double angle = static_cast<double>(frame) * 0.05;
+        push_event(m_pending, usec, EV_REL, REL_X, static_cast<int32_t>(8.0 * std::cos(angle)));
+        push_event(m_pending, usec, EV_REL, REL_Y, static_cast<int32_t>(8.0 * std::sin(angle)));
+        if (frame % 100 == 0)
+        {
+          push_event(m_pending, usec, EV_REL, REL_WHEEL, (frame / 100) % 2 == 0 ? 1 : -1);
+        }
+        if (frame % 25 == 0)
+        {
+          const uint16_t button = static_cast<uint16_t>(BTN_LEFT + (frame / 50) % 3);
+          push_event(m_pending, usec, EV_KEY, button, (frame / 25) % 2 == 0);
+        }
+      }
+      break;
+
+    case kKeyboard:
+      {
+        // type through all keys, one press or release per report
+        const uint16_t code = static_cast<uint16_t>(KEY_ESC + (frame / 2) % (KEY_KPDOT - KEY_ESC + 1));
+        push_event(m_pending, usec, EV_MSC, MSC_SCAN, code);
+        push_event(m_pending, usec, EV_KEY, code, frame % 2 == 0);
+      }
+      break;
+  }
+
+  push_event(m_pending, usec, EV_SYN, SYN_REPORT, 0);
+}
+
+/* EOF */
@@ -0,0 +1,66 @@
+// evtest-qt - A graphical joystick tester
+// Copyright (C) 2015 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HEADER_SYNTHETIC_SOURCE_HPP
+#define HEADER_SYNTHETIC_SOURCE_HPP
+
+#include <stdint.h>
+#include <vector>
+
+#include "event_source.hpp"
+
+/** Generates the events of a gamepad, mouse or keyboard in memory at
+    a fixed report rate, so the event pipeline can be exercised and
+    load tested without any hardware. A timerfd serves as the
+    readiness fd. */
+class SyntheticSource : public EventSource
+{
+public:
+  enum Profile { kGamepad, kMouse, kKeyboard };
+
+  /** Parses "gamepad", "mouse" or "keyboard", throws on anything else */
+  static Profile parse_profile(const std::string& name);
+
+  static EvdevInfo make_info(Profile profile);
+
+private:
+  Profile m_profile;
+  std::string m_filename;
+  EvdevInfo m_info;
+  int m_timer_fd;
+  uint64_t m_interval_usec;
+  uint64_t m_frame;
+
+  // generated but not yet returned by read_events()
+  std::vector<struct input_event> m_pending;
+  size_t m_pending_pos;
+
+public:
+  /** Produce one report every 1/\a rate seconds */
+  SyntheticSource(Profile profile, int rate);
+  ~SyntheticSource() override;
+
+  EvdevInfo read_evdev_info() override { return m_info; }
+  ssize_t read_events(struct input_event* ev, size_t count) override;
+  int get_fd() const override { return m_timer_fd; }
+  const std::string& get_filename() const override { return m_filename; }
+
+private:
+  void generate_frame(uint64_t usec);
+};
+
+#endif
+
+/* EOF */